@@ -0,0 +1,181 @@
+// Synthetic program generator for the benchmarks (see run_bench.sh).
+//
+//   genprog [--polys N] [--arity A] [--degree D] [--depth K]
+//           [--statements S] [--inputs I] [--vars V] [--seed X] [--tasks "1 2"]
+//
+// Writes a valid program to stdout: N polynomials F0..F{N-1} with 1..A
+// parameters and terms of total degree at most D, K levels of parentheses in
+// the bodies and of nested calls in the arguments, S statements over V
+// variables and I numbers after INPUTS. The same options and seed always give
+// the same program.
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct Options {
+    int polys = 20;
+    int arity = 3;
+    int degree = 4;
+    int depth = 1;
+    int statements = 1000;
+    int inputs = 100;
+    int vars = 16;
+    uint64_t seed = 1;
+    string tasks = "1 2";
+};
+
+// xorshift64*, so the output does not depend on the standard library.
+class Random {
+  public:
+    explicit Random(uint64_t seed) : state(seed ? seed : 1) {}
+    uint64_t Next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+    // Uniform in [lo, hi].
+    int Range(int lo, int hi) { return lo + (int) (Next() % (uint64_t) (hi - lo + 1)); }
+    bool Chance(int percent) { return Range(1, 100) <= percent; }
+
+  private:
+    uint64_t state;
+};
+
+static string paramName(int i)
+{
+    return "x" + to_string(i);
+}
+
+// term_list with every term of total degree at most maxDegree.
+static void termList(ostream& os, Random& r, int arity, int maxDegree, int depth)
+{
+    int terms = r.Range(1, 4);
+    for (int t = 0; t < terms; t++) {
+        if (t > 0)
+            os << (r.Chance(70) ? " + " : " - ");
+        bool coefficient = r.Chance(60);
+        if (coefficient)
+            os << r.Range(1, 99);
+        int left = r.Range(0, maxDegree);
+        if (left == 0 && !coefficient)
+            os << r.Range(1, 99);
+        for (bool first = !coefficient; left > 0; first = false) {
+            if (!first)
+                os << " ";
+            if (depth > 0 && left >= 2 && r.Chance(25)) {
+                int power = r.Range(1, 2);
+                int inner = max(1, left / power);
+                os << "(";
+                termList(os, r, arity, inner, depth - 1);
+                os << ")";
+                if (power > 1)
+                    os << "^" << power;
+                left -= inner * power;
+            } else {
+                int exponent = r.Range(1, left);
+                os << paramName(r.Range(0, arity - 1));
+                if (exponent > 1)
+                    os << "^" << exponent;
+                left -= exponent;
+            }
+        }
+    }
+}
+
+static void call(ostream& os, Random& r, const Options& o, const vector<int>& arities,
+                 int initializedVars, int depth)
+{
+    int f = r.Range(0, o.polys - 1);
+    os << "F" << f << "(";
+    for (int a = 0; a < arities[f]; a++) {
+        if (a > 0)
+            os << ", ";
+        int kind = r.Range(1, 10);
+        if (depth > 0 && kind == 1)
+            call(os, r, o, arities, initializedVars, depth - 1);
+        else if (kind <= 3)
+            os << r.Range(0, 9);
+        else
+            os << "v" << r.Range(0, initializedVars - 1);
+    }
+    os << ")";
+}
+
+static void usage()
+{
+    cerr << "usage: genprog [--polys N] [--arity A] [--degree D] [--depth K]"
+            " [--statements S] [--inputs I] [--vars V] [--seed X] [--tasks LIST]" << endl;
+    exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc)
+            usage();
+        const char* value = argv[++i];
+        if (arg == "--polys") o.polys = atoi(value);
+        else if (arg == "--arity") o.arity = atoi(value);
+        else if (arg == "--degree") o.degree = atoi(value);
+        else if (arg == "--depth") o.depth = atoi(value);
+        else if (arg == "--statements") o.statements = atoi(value);
+        else if (arg == "--inputs") o.inputs = atoi(value);
+        else if (arg == "--vars") o.vars = atoi(value);
+        else if (arg == "--seed") o.seed = strtoull(value, nullptr, 10);
+        else if (arg == "--tasks") o.tasks = value;
+        else usage();
+    }
+    if (o.polys < 1 || o.arity < 1 || o.degree < 1 || o.depth < 0 ||
+        o.statements < 1 || o.inputs < 1 || o.vars < 1)
+        usage();
+
+    Random r(o.seed);
+    ostringstream os;
+    os << "TASKS " << o.tasks << "\nPOLY\n";
+    vector<int> arities;
+    for (int f = 0; f < o.polys; f++) {
+        int arity = r.Range(1, o.arity);
+        arities.push_back(arity);
+        os << "    F" << f << "(";
+        for (int p = 0; p < arity; p++)
+            os << (p ? ", " : "") << paramName(p);
+        os << ") = ";
+        termList(os, r, arity, o.degree, o.depth);
+        os << ";\n";
+    }
+
+    // Variables are only used once initialized: the first ones by an INPUT
+    // (one per input value at most), the others by an assignment.
+    os << "EXECUTE\n";
+    int inputStatements = min(min(o.vars, o.inputs), o.statements);
+    for (int v = 0; v < inputStatements; v++)
+        os << "    INPUT v" << v << ";\n";
+    int initialized = inputStatements;
+    for (int s = inputStatements; s < o.statements; s++) {
+        if (r.Chance(25)) {
+            os << "    OUTPUT v" << r.Range(0, initialized - 1) << ";\n";
+        } else {
+            int lhs = r.Range(0, min(initialized, o.vars - 1));
+            os << "    v" << lhs << " = ";
+            call(os, r, o, arities, initialized, o.depth);
+            os << ";\n";
+            initialized = max(initialized, lhs + 1);
+        }
+    }
+
+    os << "INPUTS\n   ";
+    for (int i = 0; i < o.inputs; i++)
+        os << " " << r.Range(1, 1000);
+    os << "\n";
+    cout << os.str();
+    return 0;
+}
@@ -0,0 +1,124 @@
+#!/bin/bash
+#
+# Benchmarks the lexer, parser and executor on programs from genprog.
+#
+#   bench/run_bench.sh [--reps N] [--tolerance PCT] [--update-baseline]
+#
+# Builds a.out with -O2 and genprog, generates one program per benchmark
+# below, and runs each --reps times (default 3) with --stats, keeping the
+# fastest run. Prints per-phase times and throughput, then how time grows
+# across the size_* series. A benchmark more than --tolerance percent
+# (default 20) slower than bench/baseline.txt is flagged as a regression and
+# the script exits with status 1. --update-baseline rewrites baseline.txt
+# from this run; baselines only mean something on the machine that made them.
+
+cd "$(dirname "$0")"
+
+reps=3
+tolerance=20
+update=0
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --reps) reps=$2; shift ;;
+        --tolerance) tolerance=$2; shift ;;
+        --update-baseline) update=1 ;;
+        *) echo "usage: $0 [--reps N] [--tolerance PCT] [--update-baseline]"; exit 1 ;;
+    esac
+    shift
+done
+
+# name polys arity degree depth statements inputs
+benchmarks="
+size_1k        10  3  4 1    1000    100
+size_10k      100  3  4 1   10000   1000
+size_100k    1000  3  4 1  100000  10000
+size_1m      1000  3  4 1 1000000 100000
+high_degree    50  1 60 0   20000    100
+wide_arity     50  8  6 1   20000    100
+deep_nesting  100  3  8 4   20000   1000
+"
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+g++ -std=c++11 -O2 -pthread ../*.cc -o "$work/a.out" || exit 1
+g++ -std=c++11 -O2 genprog.cc -o "$work/genprog" || exit 1
+
+# Prints the "ms" of one phase from a --stats line.
+phase_ms() {
+    sed -n "s/.*\"$1\": {\"ms\": \([0-9.e+-]*\).*/\1/p" <<< "$2"
+}
+
+stat_value() {
+    sed -n "s/.*\"$1\": \([0-9.e+-]*\).*/\1/p" <<< "$2"
+}
+
+results="$work/results"
+: > "$results"
+printf "%-13s %8s %9s %9s %9s %9s %9s %10s %12s %12s\n" \
+    benchmark stmts tokens lex_ms parse_ms comp_ms exec_ms total_ms stmts/s tokens/s
+while read -r name polys arity degree depth statements inputs; do
+    [ -z "$name" ] && continue
+    program="$work/$name.txt"
+    "$work/genprog" --polys "$polys" --arity "$arity" --degree "$degree" \
+        --depth "$depth" --statements "$statements" --inputs "$inputs" > "$program"
+
+    best=""
+    best_stats=""
+    for ((i = 0; i < reps; i++)); do
+        start=$(date +%s%N)
+        "$work/a.out" --stats < "$program" > /dev/null 2> "$work/stats"
+        end=$(date +%s%N)
+        ms=$(( (end - start) / 1000000 ))
+        if [ -z "$best" ] || [ "$ms" -lt "$best" ]; then
+            best=$ms
+            best_stats=$(< "$work/stats")
+        fi
+    done
+
+    tokens=$(stat_value tokens "$best_stats")
+    echo "$name $best" >> "$results"
+    awk -v n="$name" -v s="$statements" -v t="$tokens" -v ms="$best" \
+        -v lex="$(phase_ms lex "$best_stats")" -v parse="$(phase_ms parse "$best_stats")" \
+        -v comp="$(phase_ms compile "$best_stats")" -v exec="$(phase_ms execute "$best_stats")" \
+        'BEGIN { d = (ms > 0 ? ms : 1) / 1000;
+                 printf "%-13s %8d %9d %9.1f %9.1f %9.1f %9.1f %10d %12.0f %12.0f\n",
+                        n, s, t, lex, parse, comp, exec, ms, s / d, t / d }'
+done <<< "$benchmarks"
+
+echo
+echo "Scaling (size_* series, each 10x the statements of the one before):"
+awk '/^size_/ { if (prev != "") printf "  %-10s -> %-10s %6.1fx time\n", prevname, $1, ($2 > 0 ? $2 : 1) / (prev > 0 ? prev : 1);
+                prev = $2; prevname = $1 }' "$results"
+
+if [ $update -eq 1 ]; then
+    {
+        echo "# name total_ms, written by run_bench.sh --update-baseline"
+        cat "$results"
+    } > baseline.txt
+    echo
+    echo "Baseline updated."
+    exit 0
+fi
+
+if [ ! -e baseline.txt ]; then
+    echo
+    echo "No baseline.txt; run with --update-baseline to create one."
+    exit 0
+fi
+
+# Differences of a few milliseconds are noise, whatever the percentage.
+echo
+awk -v tol="$tolerance" '
+    FNR == NR { if ($1 !~ /^#/) base[$1] = $2; next }
+    ($1 in base) {
+        limit = base[$1] * (1 + tol / 100)
+        if ($2 > limit && $2 - base[$1] > 5) {
+            printf "REGRESSION %-13s %d ms, baseline %d ms\n", $1, $2, base[$1]
+            bad = 1
+        }
+    }
+    END {
+        if (bad) exit 1
+        print "No regressions against baseline.txt (tolerance " tol "%)."
+    }' baseline.txt "$results"
@@ -13,12 +13,20 @@
 
 using namespace std;
 
+InputBuffer::InputBuffer() : in(&cin)
+{
+}
+
+InputBuffer::InputBuffer(istream& stream) : in(&stream)
+{
+}
+
 bool InputBuffer::EndOfInput()
 {
     if (!input_buffer.empty())
         return false;
     else
-        return cin.eof();
+        return in->eof();
 }
 
 char InputBuffer::UngetChar(char c)
@@ -34,7 +42,7 @@ void InputBuffer::GetChar(char& c)
         c = input_buffer.back();
         input_buffer.pop_back();
     } else {
-        cin.get(c);
+        in->get(c);
     }
 }
 
@@ -44,3 +52,19 @@ string InputBuffer::UngetString(string s)
         input_buffer.push_back(s[s.size()-i-1]);
     return s;
 }
+
+// Reads up to n characters into buf, ungotten characters first, and returns
+// how many were read; 0 means end of input.
+size_t InputBuffer::GetChars(char* buf, size_t n)
+{
+    size_t count = 0;
+    while (count < n && !input_buffer.empty()) {
+        buf[count++] = input_buffer.back();
+        input_buffer.pop_back();
+    }
+    if (count < n) {
+        in->read(buf + count, n - count);
+        count += in->gcount();
+    }
+    return count;
+}
@@ -6,18 +6,23 @@
 #ifndef __INPUT_BUFFER__H__
 #define __INPUT_BUFFER__H__
 
+#include <istream>
 #include <string>
 #include <vector>
 
 class InputBuffer {
   public:
+    InputBuffer();
+    explicit InputBuffer(std::istream&);
     void GetChar(char&);
     char UngetChar(char);
     std::string UngetString(std::string);
     bool EndOfInput();
+    size_t GetChars(char*, size_t);
 
   private:
     std::vector<char> input_buffer;
+    std::istream* in;       // std::cin unless another stream is given
 };
 
 #endif  //__INPUT_BUFFER__H__
@@ -33,6 +33,21 @@ void Token::Print()
 // internal vector. This faciliates the implementation of peek()
 LexicalAnalyzer::LexicalAnalyzer()
 {
+    Tokenize();
+}
+
+// Same, reading from the given stream instead of standard input
+LexicalAnalyzer::LexicalAnalyzer(istream& stream) : input(stream)
+{
+    Tokenize();
+}
+
+void LexicalAnalyzer::Tokenize()
+{
+#if POLY_STATS
+    double start = WallSeconds();
+    uint64_t startAllocations = AllocationCount();
+#endif
     this->line_no = 1;
     tmp.lexeme = "";
     tmp.line_no = 1;
@@ -44,9 +59,15 @@ LexicalAnalyzer::LexicalAnalyzer()
     while (token.token_type != END_OF_FILE)
     {
         tokenList.push_back(token);     // push token into internal list
+        if (token.token_type == INPUTS) // the numbers after INPUTS are left
+            break;                      // for ReadInputNumbers()
         token = GetTokenMain();        // and get next token from standatd input
     }
     // pushes END_OF_FILE is not pushed on the token list
+#if POLY_STATS
+    tokenizeStats.seconds = WallSeconds() - start;
+    tokenizeStats.allocations = AllocationCount() - startAllocations;
+#endif
 
 }
 
@@ -190,6 +211,69 @@ Token LexicalAnalyzer::peek(int howFar)
         return tokenList[peekIndex];
 }
 
+// peekType is peek without copying the token; the parser only needs the
+// type to choose a production.
+TokenType LexicalAnalyzer::peekType(int howFar)
+{
+    if (howFar <= 0) {      // peeking backward or in place is not allowed
+        cout << "LexicalAnalyzer:peekType:Error: non positive argument\n";
+        exit(-1);
+    }
+
+    size_t peekIndex = index + howFar - 1;
+    if (peekIndex >= tokenList.size())
+        return END_OF_FILE;
+    return tokenList[peekIndex].token_type;
+}
+
+// ReadInputNumbers() parses the rest of the input, the list of numbers after
+// INPUTS, straight from the input buffer without building tokens. Numbers
+// follow ScanNumber(): a 0 always stands alone, so "05" is 0 followed by 5.
+// Returns false if the list is empty or contains anything but numbers and
+// space, which the parser reports as a syntax error. With values == nullptr
+// the list is only checked.
+bool LexicalAnalyzer::ReadInputNumbers(vector<int>* values)
+{
+    char buf[1 << 16];
+    size_t count = 0;
+    bool inNumber = false;
+    bool loneZero = false;      // the number being read started with 0
+    unsigned value = 0;
+
+    while (true) {
+        size_t n = input.GetChars(buf, sizeof(buf));
+        if (n == 0)
+            break;
+        for (size_t i = 0; i < n; i++) {
+            char c = buf[i];
+            if (c >= '0' && c <= '9') {
+                if (inNumber && !loneZero) {
+                    value = value * 10 + (c - '0');
+                    continue;
+                }
+                if (inNumber && values) // previous number was a lone 0
+                    values->push_back(0);
+                count += inNumber;
+                inNumber = true;
+                loneZero = (c == '0');
+                value = c - '0';
+            } else if (isspace((unsigned char) c)) {
+                if (inNumber && values)
+                    values->push_back((int) value);
+                count += inNumber;
+                inNumber = false;
+                line_no += (c == '\n');
+            } else {
+                return false;
+            }
+        }
+    }
+    if (inNumber && values)
+        values->push_back((int) value);
+    count += inNumber;
+    return count > 0;
+}
+
 Token LexicalAnalyzer::GetTokenMain()
 {
     char c;
@@ -10,6 +10,7 @@
 #include <string>
 
 #include "inputbuf.h"
+#include "stats.h"
 
 // ------- token types -------------------
 
@@ -33,7 +34,14 @@ class LexicalAnalyzer {
   public:
     Token GetToken();
     Token peek(int);
+    TokenType peekType(int);
+    bool ReadInputNumbers(std::vector<int>*);
+#if POLY_STATS
+    PhaseStats TokenizeStats() const { return tokenizeStats; }
+    size_t TokenCount() const { return tokenList.size(); }
+#endif
     LexicalAnalyzer();
+    explicit LexicalAnalyzer(std::istream&);
 
   private:
     std::vector<Token> tokenList;
@@ -42,7 +50,11 @@ class LexicalAnalyzer {
     int index;
     Token tmp;
     InputBuffer input;
+#if POLY_STATS
+    PhaseStats tokenizeStats;
+#endif
 
+    void Tokenize();
     bool SkipSpace();
     bool IsKeyword(std::string);
     TokenType FindKeywordIndex(std::string);
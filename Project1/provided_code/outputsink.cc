@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "outputsink.h"
+
+using namespace std;
+
+#define SINK_BUFFER_SIZE (1 << 16)
+
+OutputSink::OutputSink()
+{
+    format = OUTPUT_TEXT;
+    stream = nullptr;
+    headerWritten = false;
+    buffer.reserve(SINK_BUFFER_SIZE);
+}
+
+OutputSink::~OutputSink()
+{
+    Flush();
+}
+
+void OutputSink::SetFormat(OutputFormat f)
+{
+    format = f;
+}
+
+void OutputSink::SetStream(ostream* s)
+{
+    Flush();
+    stream = s;
+}
+
+void OutputSink::Append(const char* p, size_t n)
+{
+    if (buffer.size() + n > SINK_BUFFER_SIZE)
+        Flush();
+    buffer.insert(buffer.end(), p, p + n);
+}
+
+void OutputSink::AppendInt(int value)
+{
+    char digits[16];
+    int n = 0;
+    unsigned u = value < 0 ? 0u - (unsigned) value : (unsigned) value;
+    do {
+        digits[15 - n++] = '0' + u % 10;
+        u /= 10;
+    } while (u != 0);
+    if (value < 0)
+        digits[15 - n++] = '-';
+    Append(digits + 16 - n, n);
+}
+
+void OutputSink::WriteValue(const string& var, int value)
+{
+    if (format == OUTPUT_BINARY) {
+        Append((const char*) &value, sizeof(value));
+    } else if (format == OUTPUT_CSV) {
+        if (!headerWritten) {
+            Append("variable,value\n", 15);
+            headerWritten = true;
+        }
+        Append(var.data(), var.size());
+        Append(",", 1);
+        AppendInt(value);
+        Append("\n", 1);
+    } else {
+        AppendInt(value);
+        Append("\n", 1);
+    }
+}
+
+void OutputSink::Flush()
+{
+    if (stream != nullptr) {
+        stream->write(buffer.data(), buffer.size());
+        stream->flush();
+        buffer.clear();
+        return;
+    }
+    if (!buffer.empty()) {
+        fwrite(buffer.data(), 1, buffer.size(), stdout);
+        buffer.clear();
+    }
+    fflush(stdout);
+}
@@ -0,0 +1,35 @@
+#ifndef __OUTPUT_SINK__H__
+#define __OUTPUT_SINK__H__
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// How the values of OUTPUT statements are written.
+//   OUTPUT_TEXT   one decimal value per line (the default)
+//   OUTPUT_CSV    a "variable,value" header, then one row per OUTPUT
+//   OUTPUT_BINARY each value as a native-endian 32-bit int, nothing else
+enum OutputFormat { OUTPUT_TEXT, OUTPUT_CSV, OUTPUT_BINARY };
+
+// Collects program output in a large buffer and hands it to stdout (or the
+// stream given to SetStream()) in batches instead of flushing every line.
+// Call Flush() before exit().
+class OutputSink {
+  public:
+    OutputSink();
+    ~OutputSink();
+    void SetFormat(OutputFormat);
+    void SetStream(std::ostream*);
+    void WriteValue(const std::string& var, int value);
+    void Flush();
+
+  private:
+    OutputFormat format;
+    std::ostream* stream;       // nullptr: write to stdout
+    bool headerWritten;
+    std::vector<char> buffer;
+    void Append(const char*, size_t);
+    void AppendInt(int);
+};
+
+#endif  //__OUTPUT_SINK__H__
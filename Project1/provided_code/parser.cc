@@ -1,14 +1,29 @@
 #include "parser.h"
+#include "progcache.h"
+#include "server.h"
 #include <iostream>
 #include <cstdlib>
+#include <climits>
 #include <algorithm>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 
 using namespace std;
 
 // ####################### Error Handling #######################
 void Parser::syntax_error() {
-    cout << "SYNTAX ERROR !!!!!&%!!" << endl;
+    *os << "SYNTAX ERROR !!!!!&%!!" << endl;
+    stop();
+}
+ 
+void Parser::stop() {
+    out.Flush();
+    os->flush();
+    if (throwOnError)
+        throw ParseStopped();
     exit(1);
 }
 
@@ -21,11 +36,58 @@ Token Parser::expect(TokenType expected_type) {
 }
 
 // ####################### Constructor #######################
-Parser::Parser() : nextAvailable(0), stmtList(nullptr), mem(1000, 0) {
+Parser::Parser() {
+    os = &cout;
+    init();
+}
+ 
+Parser::Parser(std::istream &in, std::ostream &output) : lexer(in) {
+    os = &output;
+    out.SetStream(&output);
+    init();
+}
+ 
+void Parser::init() {
+    nextAvailable = 0;
+    stmtList = nullptr;
+    stmtTail = nullptr;
+    buildProgram = false;
+    debugOutput = false;
+    throwOnError = false;
+    lazyExecution = false;
+    numThreads = 1;
+    cachedBody = nullptr;
+    cachedBodySize = 0;
+    cacheKey = 0;
+    cacheProgram = nullptr;
+    cacheProgramSize = 0;
+    keepCompiled = false;
+    currentPoly = -1;
     for (int i = 0; i < 7; i++) {
         tasks[i] = false;
     }
 }
+ 
+TermList* Parser::newTermList() {
+    termLists.push_back(std::unique_ptr<TermList>(new TermList));
+    return termLists.back().get();
+}
+ 
+PolyEval* Parser::newPolyEval() {
+    polyEvals.push_back(std::unique_ptr<PolyEval>(new PolyEval));
+    return polyEvals.back().get();
+}
+ 
+// The server builds a Parser per request, so everything is freed here. The
+// TermList and PolyEval nodes go with termLists and polyEvals.
+Parser::~Parser() {
+    Statement* curr = stmtList;
+    while (curr != nullptr) {
+        Statement* next = curr->next;
+        delete curr;
+        curr = next;
+    }
+}
 
 // ####################### ConsumeAllInput() #######################
 void Parser::ConsumeAllInput() {
@@ -48,79 +110,155 @@ void Parser::ConsumeAllInput() {
 
 // ####################### input() #######################
 void Parser::input() {
-    program();
-    expect(END_OF_FILE);
+    {
+        PhaseTimer timer(stats, PHASE_PARSE);
+        if (cachedBody != nullptr) {
+            if (!loadCompiled(cachedBody, cachedBodySize)) {
+                *os << "Error: corrupt program cache." << endl;
+                stop();
+            }
+            inputs_section();
+        } else {
+            program();
+        }
+        expect(END_OF_FILE);
+    }
+
+    // Tasks 2-4 need a valid program, so they run the semantic checks too.
+    if (tasks[1] || tasks[2] || tasks[3] || tasks[4]) {
+        PhaseTimer timer(stats, PHASE_CHECK);
+        checkSemantics();
+    }
+
+    // A cached program comes with its polynomials already compiled, and
+    // compiling first puts them in what is saved.
+    if (tasks[2] && cachedBody == nullptr) {
+        PhaseTimer timer(stats, PHASE_COMPILE);
+        compilePolynomials();
+    }
+    if (!cacheSavePath.empty())
+        saveCompiled(cacheSavePath, cacheKey);
+    if (keepCompiled)
+        compiledBody = serializeCompiled();
 
-    // --- Semantic Error Checks ---
+    if (tasks[2])
+        runProgram();
+    {
+        PhaseTimer timer(stats, PHASE_ANALYZE);
+        if (tasks[3])
+            warnUninitialized();
+        if (tasks[4])
+            warnUselessAssignments();
+        if (tasks[5])
+            printDegrees();
+    }
+
+    if (stats.enabled)
+        writeStats();
+}
+
+// ####################### Task 1: semantic checks #######################
+void Parser::checkSemantics() {
     if (!duplicateLines.empty()) {
         sort(duplicateLines.begin(), duplicateLines.end());
-        cout << "Semantic Error Code 1:";
+        *os << "Semantic Error Code 1:";
         for (size_t i = 0; i < duplicateLines.size(); i++) {
-            cout << " " << duplicateLines[i];
+            *os << " " << duplicateLines[i];
         }
-        cout << endl;
-        exit(1);
+        *os << endl;
+        stop();
     }
     if (!invalidMonomialLines.empty()) {
         sort(invalidMonomialLines.begin(), invalidMonomialLines.end());
-        cout << "Semantic Error Code 2:";
+        *os << "Semantic Error Code 2:";
         for (size_t i = 0; i < invalidMonomialLines.size(); i++) {
-            cout << " " << invalidMonomialLines[i];
+            *os << " " << invalidMonomialLines[i];
         }
-        cout << endl;
-        exit(1);
+        *os << endl;
+        stop();
     }
     if (!undefinedPolyUseLines.empty()) {
         sort(undefinedPolyUseLines.begin(), undefinedPolyUseLines.end());
-        cout << "Semantic Error Code 3:";
+        *os << "Semantic Error Code 3:";
         for (size_t i = 0; i < undefinedPolyUseLines.size(); i++) {
-            cout << " " << undefinedPolyUseLines[i];
+            *os << " " << undefinedPolyUseLines[i];
         }
-        cout << endl;
-        exit(1);
+        *os << endl;
+        stop();
     }
     if (!wrongArgCountLines.empty()) {
         sort(wrongArgCountLines.begin(), wrongArgCountLines.end());
-        cout << "Semantic Error Code 4:";
+        *os << "Semantic Error Code 4:";
         for (size_t i = 0; i < wrongArgCountLines.size(); i++) {
-            cout << " " << wrongArgCountLines[i];
+            *os << " " << wrongArgCountLines[i];
         }
-        cout << endl;
-        exit(1);
+        *os << endl;
+        stop();
     }
+}
 
+// ####################### Task 2: execution #######################
+void Parser::runProgram() {
+    mem.assign(nextAvailable, 0);
     // --- Debug Print Runtime Data Structures ---
-    cout << "Symbol Table:" << endl;
-    for (auto &entry : symbolTable) {
-         cout << "Variable: " << entry.first << " => Memory Location: " << entry.second << endl;
-    }
-    
-    cout << "Initial Memory (first 10 locations):" << endl;
-    for (int i = 0; i < 10; i++) {
-         cout << "mem[" << i << "] = " << mem[i] << endl;
-    }
-    
-    cout << "Input Values:" << endl;
-    for (size_t i = 0; i < inputValues.size(); i++) {
-         cout << inputValues[i] << " ";
+    if (debugOutput) {
+        *os << "Symbol Table:" << endl;
+        for (auto &entry : symbolTable) {
+             *os << "Variable: " << entry.first << " => Memory Location: " << entry.second << endl;
+        }
+        
+        *os << "Initial Memory (first 10 locations):" << endl;
+        for (int i = 0; i < 10 && i < (int) mem.size(); i++) {
+             *os << "mem[" << i << "] = " << mem[i] << endl;
+        }
+        
+        *os << "Input Values:" << endl;
+        for (size_t i = 0; i < inputValues.size(); i++) {
+             *os << inputValues[i] << " ";
+        }
+        *os << endl;
     }
-    cout << endl;
-
-    // --- Execute INPUT statements ---
-    executeInputStatements();
 
-    // --- Execute full program (ASSIGN and OUTPUT statements) ---
-    executeProgram();
+    // --- Execute the program (INPUT, ASSIGN and OUTPUT statements) ---
+    PhaseTimer timer(stats, PHASE_EXECUTE);
+    if (lazyExecution)
+        markNeeded();
+    if (numThreads > 1)
+        executeParallel();
+    else
+        executeProgram();
 }
 
 // ####################### program() #######################
 void Parser::program() {
     tasks_section();
+    buildProgram = tasks[2] || tasks[3] || tasks[4];
     poly_section();
     execute_section();
     inputs_section();
 }
  
+// ####################### NUM values #######################
+// NUM lexemes can have any number of digits. Coefficients and constant
+// arguments are taken mod 2^32, like all evaluation arithmetic; task numbers
+// and exponents saturate at INT_MAX instead.
+static unsigned numberMod32(const std::string &lexeme) {
+    unsigned value = 0;
+    for (char c : lexeme)
+        value = value * 10 + (c - '0');
+    return value;
+}
+
+static int numberSaturated(const std::string &lexeme) {
+    long long value = 0;
+    for (char c : lexeme) {
+        value = value * 10 + (c - '0');
+        if (value > INT_MAX)
+            return INT_MAX;
+    }
+    return (int) value;
+}
+
 // ####################### tasks_section #######################
 void Parser::tasks_section() {
     expect(TASKS);
@@ -130,13 +268,13 @@ void Parser::tasks_section() {
 // num_list → NUM | NUM num_list
 void Parser::tasknum_list() {
     Token t = expect(NUM);
-    int task_num = stoi(t.lexeme);
+    int task_num = numberSaturated(t.lexeme);
     if (task_num < 1 || task_num > 6)
         syntax_error();
     tasks[task_num] = true;
-    while (lexer.peek(1).token_type == NUM) {
+    while (lexer.peekType(1) == NUM) {
         t = expect(NUM);
-        task_num = stoi(t.lexeme);
+        task_num = numberSaturated(t.lexeme);
         if (task_num < 1 || task_num > 6)
             syntax_error();
         tasks[task_num] = true;
@@ -152,12 +290,12 @@ void Parser::poly_section() {
 // poly_decl_list → poly_decl | poly_decl poly_decl_list
 void Parser::poly_decl_list() {
     poly_decl();
-    Token t = lexer.peek(1);
-    while (t.token_type == ID) {
+    TokenType t = lexer.peekType(1);
+    while (t == ID) {
         poly_decl();
-        t = lexer.peek(1);
+        t = lexer.peekType(1);
     }
-    if (t.token_type != EXECUTE)
+    if (t != EXECUTE)
         syntax_error();
 }
  
@@ -165,9 +303,9 @@ void Parser::poly_decl_list() {
 void Parser::poly_decl() {
     poly_header();
     expect(EQUAL);
-    currentPolyParams = polyHeaders.back().paramNames;
-    poly_body();
-    currentPolyParams.clear();
+    currentPoly = polyHeaders.size() - 1;
+    polyHeaders.back().body = poly_body();
+    currentPoly = -1;
     expect(SEMICOLON);
 }
  
@@ -181,7 +319,7 @@ std::vector<std::string> Parser::id_list() {
     std::vector<std::string> result;
     Token firstID = expect(ID);
     result.push_back(firstID.lexeme);
-    while (lexer.peek(1).token_type == COMMA) {
+    while (lexer.peekType(1) == COMMA) {
         expect(COMMA);
         Token nextID = expect(ID);
         result.push_back(nextID.lexeme);
@@ -195,119 +333,146 @@ void Parser::poly_header() {
     PolyHeaderInfo current;
     current.name = nameToken.lexeme;
     current.line_no = nameToken.line_no; 
+    current.body = nullptr;
+    current.calls = 0;
+    current.form = FORM_TREE;
 
-    // Duplicate checking (Semantic Error Code 1)
-    for (size_t i = 0; i < polyHeaders.size(); i++) {
-        if (polyHeaders[i].name == current.name) {
-            duplicateLines.push_back(current.line_no);
-            break;
-        }
+    // Duplicate checking (Semantic Error Code 1); the first declaration stays in the table.
+    if (!polyTable.insert({current.name, (int) polyHeaders.size()}).second) {
+        duplicateLines.push_back(current.line_no);
     }
-    declaredPolynomials.insert(current.name);
     
-    if (lexer.peek(1).token_type == LPAREN) {
+    if (lexer.peekType(1) == LPAREN) {
         expect(LPAREN);
         current.paramNames = id_list();
         expect(RPAREN);
     } else {
         current.paramNames.push_back("x");
     }
+    // A repeated parameter name keeps its first position.
+    for (size_t i = 0; i < current.paramNames.size(); i++) {
+        current.paramIndex.insert({current.paramNames[i], (int) i});
+    }
     polyHeaders.push_back(current);
 }
  
 // poly_body → term_list
-void Parser::poly_body() {
-    term_list();
+TermList* Parser::poly_body() {
+    return term_list();
 }
  
 // term_list → term | term add_operator term_list
-void Parser::term_list() {
-    term();
-    while (lexer.peek(1).token_type == PLUS || lexer.peek(1).token_type == MINUS) {
-        add_operator();
-        term();
+TermList* Parser::term_list() {
+    TermList* list = newTermList();
+    list->terms.push_back(term());
+    TokenType next = lexer.peekType(1);
+    while (next == PLUS || next == MINUS) {
+        int sign = add_operator();
+        Term t = term();
+        t.sign = sign;
+        list->terms.push_back(t);
+        next = lexer.peekType(1);
     }
+    return list;
 }
  
-void Parser::add_operator() {
-    Token t = lexer.peek(1);
-    if (t.token_type == MINUS)
+// Returns the sign the operator gives to the following term.
+int Parser::add_operator() {
+    TokenType t = lexer.peekType(1);
+    if (t == MINUS) {
          expect(MINUS);
-    else if (t.token_type == PLUS)
+         return -1;
+    }
+    else if (t == PLUS) {
          expect(PLUS);
+         return 1;
+    }
     else
          syntax_error();
+    return 1;
 }
  
 // term → coefficient | coefficient monomial_list | monomial_list
-void Parser::term() {
-    Token t = lexer.peek(1);
-    if (t.token_type == NUM) {
-         coefficient();
-         Token t1 = lexer.peek(1);
-         if (t1.token_type == ID || t1.token_type == LPAREN) {
-             monomial_list();
+Term Parser::term() {
+    Term result;
+    result.sign = 1;
+    result.coefficient = 1;
+    TokenType t = lexer.peekType(1);
+    if (t == NUM) {
+         result.coefficient = coefficient();
+         TokenType t1 = lexer.peekType(1);
+         if (t1 == ID || t1 == LPAREN) {
+             monomial_list(result.monomials);
          }
     }
-    else if (t.token_type == ID || t.token_type == LPAREN) {
-         monomial_list();
+    else if (t == ID || t == LPAREN) {
+         monomial_list(result.monomials);
     }
     else {
          syntax_error();
     }
+    return result;
 }
  
-void Parser::coefficient() {
-    expect(NUM);
+int Parser::coefficient() {
+    Token t = expect(NUM);
+    return (int) numberMod32(t.lexeme);
 }
  
 // monomial_list → monomial | monomial monomial_list
-void Parser::monomial_list() {
-    monomial();
-    while (lexer.peek(1).token_type == ID || lexer.peek(1).token_type == LPAREN) {
-         monomial();
+void Parser::monomial_list(std::vector<Monomial> &monomials) {
+    monomials.push_back(monomial());
+    TokenType next = lexer.peekType(1);
+    while (next == ID || next == LPAREN) {
+         monomials.push_back(monomial());
+         next = lexer.peekType(1);
     }
 }
  
 // monomial → primary | primary exponent
-void Parser::monomial() {
-    primary();
-    if (lexer.peek(1).token_type == POWER) {
-         exponent();
+Monomial Parser::monomial() {
+    Monomial m = primary();
+    if (lexer.peekType(1) == POWER) {
+         m.exponent = exponent();
     }
+    return m;
 }
  
 // exponent → POWER NUM
-void Parser::exponent() {
+int Parser::exponent() {
     expect(POWER);
-    expect(NUM);
+    Token t = expect(NUM);
+    return numberSaturated(t.lexeme);
 }
  
 // primary → ID | LPAREN term_list RPAREN
-void Parser::primary() {
-    if (lexer.peek(1).token_type == ID) {
+Monomial Parser::primary() {
+    Monomial m;
+    m.paramIndex = -1;
+    m.sub = nullptr;
+    m.exponent = 1;
+    TokenType t = lexer.peekType(1);
+    if (t == ID) {
          Token varTok = expect(ID);
-         if (!currentPolyParams.empty()) {
-             bool valid = false;
-             for (auto &p : currentPolyParams) {
-                 if (p == varTok.lexeme) {
-                     valid = true;
-                     break;
-                 }
-             }
-             if (!valid) {
+         if (currentPoly != -1) {
+             const PolyHeaderInfo &header = polyHeaders[currentPoly];
+             auto it = header.paramIndex.find(varTok.lexeme);
+             if (it != header.paramIndex.end()) {
+                 m.paramIndex = it->second;
+             } else {
                  invalidMonomialLines.push_back(varTok.line_no);
              }
          }
     }
-    else if (lexer.peek(1).token_type == LPAREN) {
+    else if (t == LPAREN) {
          expect(LPAREN);
-         term_list();
+         m.sub = term_list();
          expect(RPAREN);
     }
     else {
          syntax_error();
     }
+    return m;
 }
  
 // ##################### execute_section #####################
@@ -319,23 +484,23 @@ void Parser::execute_section() {
 // statement_list → statement | statement statement_list
 void Parser::statement_list() {
     statement();
-    while (lexer.peek(1).token_type == INPUT ||
-           lexer.peek(1).token_type == OUTPUT ||
-           lexer.peek(1).token_type == ID) {
+    TokenType next = lexer.peekType(1);
+    while (next == INPUT || next == OUTPUT || next == ID) {
          statement();
+         next = lexer.peekType(1);
     }
 }
  
 // statement → input_statement | output_statement | assign_statement
 void Parser::statement() {
-    Token nextToken = lexer.peek(1);
-    if (nextToken.token_type == INPUT) {
+    TokenType nextToken = lexer.peekType(1);
+    if (nextToken == INPUT) {
          input_statement();
     }
-    else if (nextToken.token_type == OUTPUT) {
+    else if (nextToken == OUTPUT) {
          output_statement();
     }
-    else if (nextToken.token_type == ID) {
+    else if (nextToken == ID) {
          assign_statement();
     }
     else {
@@ -344,33 +509,46 @@ void Parser::statement() {
 }
  
 // Helper: Create a new Statement node.
-Statement* newStatement(StmtType type, const std::string &var) {
+Statement* newStatement(StmtType type, const Token &var, int loc) {
     Statement* s = new Statement;
     s->type = type;
-    s->var = var;
+    s->var = var.lexeme;
+    s->line_no = var.line_no;
+    s->loc = loc;
+    s->eval = nullptr;
+    s->needed = true;
     s->next = nullptr;
     return s;
 }
  
+// Allocate a memory location for var if it does not have one yet.
+int Parser::allocate(const std::string &var) {
+    auto it = symbolTable.find(var);
+    if (it != symbolTable.end())
+         return it->second;
+    symbolTable[var] = nextAvailable;
+    return nextAvailable++;
+}
+ 
+void Parser::appendStatement(Statement* s) {
+    if (stmtList == nullptr) {
+         stmtList = s;
+    } else {
+         stmtTail->next = s;
+    }
+    stmtTail = s;
+}
+ 
 // input_statement → INPUT ID SEMICOLON
 void Parser::input_statement() {
     expect(INPUT);
     Token varTok = expect(ID);
     expect(SEMICOLON);
-    // Allocate variable if needed.
-    if (symbolTable.find(varTok.lexeme) == symbolTable.end()) {
-         symbolTable[varTok.lexeme] = nextAvailable++;
-    }
-    Statement* s = newStatement(STMT_INPUT, varTok.lexeme);
-    if (stmtList == nullptr) {
-         stmtList = s;
-    } else {
-         Statement* curr = stmtList;
-         while (curr->next != nullptr) {
-             curr = curr->next;
-         }
-         curr->next = s;
-    }
+    if (!buildProgram)
+        return;
+    Statement* s = newStatement(STMT_INPUT, varTok, allocate(varTok.lexeme));
+    bumpVersion(s->loc);
+    appendStatement(s);
 }
  
 // output_statement → OUTPUT ID SEMICOLON
@@ -378,92 +556,147 @@ void Parser::output_statement() {
     expect(OUTPUT);
     Token varTok = expect(ID);
     expect(SEMICOLON);
-    if (symbolTable.find(varTok.lexeme) == symbolTable.end()) {
-         symbolTable[varTok.lexeme] = nextAvailable++;
-    }
-    Statement* s = newStatement(STMT_OUTPUT, varTok.lexeme);
-    if (stmtList == nullptr) {
-         stmtList = s;
-    } else {
-         Statement* curr = stmtList;
-         while (curr->next != nullptr) {
-             curr = curr->next;
-         }
-         curr->next = s;
-    }
+    if (!buildProgram)
+        return;
+    Statement* s = newStatement(STMT_OUTPUT, varTok, allocate(varTok.lexeme));
+    appendStatement(s);
 }
  
 // assign_statement → ID EQUAL poly_evaluation SEMICOLON
 void Parser::assign_statement() {
     Token lhs = expect(ID);
     expect(EQUAL);
-    poly_evaluation();
+    PolyEval* e = poly_evaluation();
     expect(SEMICOLON);
-    if (symbolTable.find(lhs.lexeme) == symbolTable.end()) {
-         symbolTable[lhs.lexeme] = nextAvailable++;
-    }
-    Statement* s = newStatement(STMT_ASSIGN, lhs.lexeme);
-    if (stmtList == nullptr) {
-         stmtList = s;
-    } else {
-         Statement* curr = stmtList;
-         while (curr->next != nullptr) {
-             curr = curr->next;
-         }
-         curr->next = s;
-    }
+    if (!buildProgram)
+        return;
+    Statement* s = newStatement(STMT_ASSIGN, lhs, allocate(lhs.lexeme));
+    s->eval = e;
+    // The right-hand side reads the old value of the LHS, so number it first.
+    numberValues(e);
+    bumpVersion(s->loc);
+    appendStatement(s);
 }
  
 // poly_evaluation → poly_name LPAREN argument_list RPAREN
-void Parser::poly_evaluation() {
+// Returns nullptr when no program is being built (buildProgram).
+PolyEval* Parser::poly_evaluation() {
     Token polyTok = poly_name();
+    int polyIndex = -1;
     // Check for undeclared polynomial.
-    if (declaredPolynomials.find(polyTok.lexeme) == declaredPolynomials.end()) {
+    auto it = polyTable.find(polyTok.lexeme);
+    if (it == polyTable.end()) {
          undefinedPolyUseLines.push_back(polyTok.line_no);
+    } else {
+         polyIndex = it->second;
+    }
+    PolyEval* e = nullptr;
+    if (buildProgram) {
+         e = newPolyEval();
+         e->name = polyTok.lexeme;
+         e->line_no = polyTok.line_no;
+         e->polyIndex = polyIndex;
+         e->resultLoc = -1;
+         e->reused = false;
     }
     expect(LPAREN);
-    int argCount = argument_list();
+    int argCount = argument_list(e);
     expect(RPAREN);
     
-    int declaredCount = -1;
-    for (size_t i = 0; i < polyHeaders.size(); i++) {
-         if (polyHeaders[i].name == polyTok.lexeme) {
-             declaredCount = polyHeaders[i].paramNames.size();
-             break;
-         }
-    }
-    if (declaredCount != -1 && argCount != declaredCount) {
+    if (polyIndex != -1 &&
+        argCount != (int) polyHeaders[polyIndex].paramNames.size()) {
          wrongArgCountLines.push_back(polyTok.line_no);
     }
+    return e;
 }
  
 // argument_list → argument | argument COMMA argument_list
-int Parser::argument_list() {
+int Parser::argument_list(PolyEval* e) {
     int count = 0;
-    argument();
+    Argument a = argument();
+    if (e != nullptr)
+         e->args.push_back(a);
     count++;
-    while (lexer.peek(1).token_type == COMMA) {
+    while (lexer.peekType(1) == COMMA) {
          expect(COMMA);
-         argument();
+         a = argument();
+         if (e != nullptr)
+              e->args.push_back(a);
          count++;
     }
     return count;
 }
  
 // argument → ID | NUM | poly_evaluation
-void Parser::argument() {
-    Token nextToken = lexer.peek(1);
-    if (nextToken.token_type == ID) {
-         Token t1 = lexer.peek(2);
-         if (t1.token_type == LPAREN)
-              poly_evaluation();
-         else
-              expect(ID);
-    }
-    else if (nextToken.token_type == NUM)
-         expect(NUM);
+Argument Parser::argument() {
+    Argument a;
+    a.line_no = 0;
+    a.loc = -1;
+    a.value = 0;
+    a.eval = nullptr;
+    TokenType nextToken = lexer.peekType(1);
+    if (nextToken == ID) {
+         if (lexer.peekType(2) == LPAREN) {
+              a.kind = ARG_POLY;
+              a.eval = poly_evaluation();
+         }
+         else {
+              Token t = expect(ID);
+              a.kind = ARG_ID;
+              a.line_no = t.line_no;
+              if (buildProgram)
+                  a.loc = allocate(t.lexeme);
+         }
+    }
+    else if (nextToken == NUM) {
+         Token t = expect(NUM);
+         a.kind = ARG_NUM;
+         a.value = (int) numberMod32(t.lexeme);
+    }
     else
          syntax_error();
+    return a;
+}
+ 
+// ####################### Value numbering #######################
+// Every write to a location (INPUT or ASSIGN) starts a new version of it. A
+// call is keyed by the polynomial name and, per argument, the constant, the
+// version of the variable read, or the result location of a nested call.
+// The first call with a given key gets a fresh result location; later calls
+// with the same key reuse it instead of evaluating the polynomial again.
+void Parser::bumpVersion(int loc) {
+    if (loc >= (int) locVersion.size())
+         locVersion.resize(loc + 1, 0);
+    locVersion[loc]++;
+}
+ 
+void Parser::numberValues(PolyEval* e) {
+    std::string key = e->name + "(";
+    for (size_t i = 0; i < e->args.size(); i++) {
+         Argument &a = e->args[i];
+         if (a.kind == ARG_NUM) {
+             key += std::to_string(a.value);
+         } else if (a.kind == ARG_ID) {
+             int version = a.loc < (int) locVersion.size() ? locVersion[a.loc] : 0;
+             key += "v" + std::to_string(a.loc) + "." + std::to_string(version);
+         } else {
+             numberValues(a.eval);
+             key += "#" + std::to_string(a.eval->resultLoc);
+         }
+         key += ",";
+    }
+    key += ")";
+ 
+    auto it = valueTable.find(key);
+    if (it != valueTable.end()) {
+         e->resultLoc = it->second;
+         e->reused = true;
+    } else {
+         e->resultLoc = nextAvailable++;
+         valueTable[key] = e->resultLoc;
+         if (e->polyIndex != -1)
+              polyHeaders[e->polyIndex].calls++;
+    }
 }
  
 // ####################### inputs_section #######################
@@ -472,75 +705,736 @@ void Parser::inputs_section() {
     inputnum_list();
 }
  
+// num_list → NUM | NUM num_list
+// The lexer stops making tokens at INPUTS; the numbers are read directly,
+// and only kept if the program is going to run (task 2).
 void Parser::inputnum_list() {
-    Token t = expect(NUM);
-    inputValues.push_back(std::stoi(t.lexeme));
-    while (lexer.peek(1).token_type == NUM) {
-        Token t = expect(NUM);
-        inputValues.push_back(std::stoi(t.lexeme));
+    if (!lexer.ReadInputNumbers(tasks[2] ? &inputValues : nullptr))
+        syntax_error();
+}
+ 
+// ####################### Polynomial evaluation #######################
+// Arithmetic is done on unsigned ints, i.e. mod 2^32, which is what int
+// arithmetic wraps to, and the result is converted back to int.
+ 
+ 
+static unsigned power(unsigned base, int exponent) {
+    unsigned result = 1;
+    while (exponent > 0) {
+        if (exponent & 1)
+            result *= base;
+        base *= base;
+        exponent >>= 1;
     }
+    return result;
 }
  
-// Execute only the INPUT statements.
-void Parser::executeInputStatements() {
-    int inputIndex = 0;
-    Statement* curr = stmtList;
-    while (curr != nullptr) {
-        if (curr->type == STMT_INPUT) {
-            int loc = symbolTable[curr->var];
-            if (inputIndex < inputValues.size()) {
-                mem[loc] = inputValues[inputIndex];
-                inputIndex++;
+static unsigned evaluateTerms(const TermList* body, const unsigned* values) {
+    unsigned sum = 0;
+    for (const Term &t : body->terms) {
+        unsigned product = (unsigned) t.sign * (unsigned) t.coefficient;
+        for (const Monomial &m : t.monomials) {
+            unsigned base = (m.sub != nullptr) ? evaluateTerms(m.sub, values)
+                                               : values[m.paramIndex];
+            product *= power(base, m.exponent);
+        }
+        sum += product;
+    }
+    return sum;
+}
+ 
+// Evaluate a term list with the parameters bound to values.
+int Parser::evaluateTermList(const TermList* body, const unsigned* values) {
+    return (int) evaluateTerms(body, values);
+}
+ 
+// Expanded polynomials: packed exponents => coefficient. Each parameter's
+// exponent gets exponentBits() bits of the 64.
+typedef std::unordered_map<uint64_t, unsigned> SparsePoly;
+ 
+#define SPARSE_MAX_ARITY 8
+#define SPARSE_MAX_TERMS 4096
+#define DENSE_MAX_SIZE 4096
+ 
+static int exponentBits(int arity) {
+    return arity <= 4 ? 16 : 8;
+}
+ 
+static int exponentOf(uint64_t packed, int param, int bits) {
+    return (packed >> (bits * param)) & ((1u << bits) - 1);
+}
+ 
+// Multiplications evaluateTerms() does for one call.
+static long treeCost(const TermList* body) {
+    long cost = 0;
+    for (const Term &t : body->terms) {
+        cost++;
+        for (const Monomial &m : t.monomials) {
+            if (m.sub != nullptr)
+                cost += treeCost(m.sub);
+            for (int e = m.exponent; e > 0; e >>= 1)
+                cost += 2;
+        }
+    }
+    return cost;
+}
+ 
+// Returns false if the product has too many terms, an exponent that does
+// not fit in exponentBits(), or would take more than the work left (in
+// term products).
+static bool multiplySparse(const SparsePoly &a, const SparsePoly &b, int arity, SparsePoly &product,
+                           long long &work) {
+    work -= (long long) a.size() * b.size();
+    if (work < 0)
+        return false;
+    int bits = exponentBits(arity);
+    product.clear();
+    for (auto &x : a) {
+        for (auto &y : b) {
+            uint64_t packed = 0;
+            for (int p = 0; p < arity; p++) {
+                int e = exponentOf(x.first, p, bits) + exponentOf(y.first, p, bits);
+                if (e >= (1 << bits))
+                    return false;
+                packed |= (uint64_t) e << (bits * p);
+            }
+            product[packed] += x.second * y.second;
+        }
+        if (product.size() > SPARSE_MAX_TERMS)
+            return false;
+    }
+    return true;
+}
+ 
+static bool expandSparse(const TermList* body, int arity, SparsePoly &sum, long long &work) {
+    sum.clear();
+    SparsePoly product, base, result, scratch;
+    for (const Term &t : body->terms) {
+        product.clear();
+        product[0] = (unsigned) t.sign * (unsigned) t.coefficient;
+        for (const Monomial &m : t.monomials) {
+            if (m.sub != nullptr) {
+                if (!expandSparse(m.sub, arity, base, work))
+                    return false;
             } else {
-                cout << "Error: Not enough input values." << endl;
-                exit(1);
+                base.clear();
+                base[(uint64_t) 1 << (exponentBits(arity) * m.paramIndex)] = 1;
+            }
+            result.clear();
+            result[0] = 1;
+            for (int e = m.exponent; e > 0; e >>= 1) {
+                if (e & 1) {
+                    if (!multiplySparse(result, base, arity, scratch, work))
+                        return false;
+                    result.swap(scratch);
+                }
+                if (e > 1) {
+                    if (!multiplySparse(base, base, arity, scratch, work))
+                        return false;
+                    base.swap(scratch);
+                }
             }
+            if (!multiplySparse(product, result, arity, scratch, work))
+                return false;
+            product.swap(scratch);
         }
-        curr = curr->next;
+        for (auto &x : product)
+            sum[x.first] += x.second;
+        if (sum.size() > SPARSE_MAX_TERMS)
+            return false;
     }
-    // Debug: Print memory state for variables in the symbol table.
-    cout << "Memory state after executing INPUT statements:" << endl;
-    for (auto &entry : symbolTable) {
-         cout << entry.first << " (loc " << entry.second << "): " << mem[entry.second] << endl;
+    return true;
+}
+ 
+// Expand every polynomial that can be (at most SPARSE_MAX_ARITY parameters,
+// SPARSE_MAX_TERMS terms and exponents that fit exponentBits()) and keep
+// whichever of the tree, dense and sparse forms needs the fewest
+// multiplications per call:
+//   tree    treeCost()
+//   dense   one multiply-add per array entry (nested Horner)
+//   sparse  the power tables, plus one multiplication per term and factor
+// The program is straight-line, so h.calls (counted by numberValues()) is
+// how often the polynomial can be evaluated. Expanding only pays if the
+// saving over those calls is more than the expansion work, so the expansion
+// gets at most calls * treeCost() of work, in units of EXPAND_TERM_COST
+// multiplications per term product, and the expanded form is only kept if
+// it saves more than the work actually spent.
+#define EXPAND_TERM_COST 16
+
+void Parser::compilePolynomials() {
+    SparsePoly expanded;
+    for (PolyHeaderInfo &h : polyHeaders) {
+        h.form = FORM_TREE;
+        int arity = h.paramNames.size();
+        if (h.calls == 0 || h.body == nullptr || arity > SPARSE_MAX_ARITY)
+            continue;
+        long cost = treeCost(h.body);
+        long long budget = (long long) h.calls * cost / EXPAND_TERM_COST;
+        long long work = budget;
+        if (!expandSparse(h.body, arity, expanded, work))
+            continue;
+        long long spent = (budget - work) * EXPAND_TERM_COST;
+        int bits = exponentBits(arity);
+ 
+        std::vector<uint64_t> keys;
+        std::vector<int> maxExponent(arity, 0);
+        long factors = 0;
+        for (auto &x : expanded) {
+            if (x.second == 0)
+                continue;
+            keys.push_back(x.first);
+            for (int p = 0; p < arity; p++) {
+                maxExponent[p] = std::max(maxExponent[p], exponentOf(x.first, p, bits));
+                factors += (exponentOf(x.first, p, bits) != 0);
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+ 
+        long denseSize = 1, tableSize = 0;
+        for (int p = 0; p < arity; p++) {
+            denseSize = std::min<long>(denseSize * (maxExponent[p] + 1), DENSE_MAX_SIZE + 1);
+            tableSize += maxExponent[p];
+        }
+        long sparseCost = tableSize + (long) keys.size() + factors;
+        long formCost = (denseSize <= DENSE_MAX_SIZE) ? std::min(denseSize, sparseCost) : sparseCost;
+        if ((long long) h.calls * (cost - formCost) <= spent)
+            continue;
+        if (denseSize <= DENSE_MAX_SIZE && denseSize <= cost && denseSize <= sparseCost) {
+            h.form = FORM_DENSE;
+            h.coefficients.assign(denseSize, 0);
+            for (uint64_t key : keys) {
+                long index = 0;
+                for (int p = arity - 1; p >= 0; p--)
+                    index = index * (maxExponent[p] + 1) + exponentOf(key, p, bits);
+                h.coefficients[index] = expanded[key];
+            }
+        } else if (sparseCost < cost) {
+            h.form = FORM_SPARSE;
+            h.exponents = keys;
+            h.coefficients.clear();
+            for (uint64_t key : keys)
+                h.coefficients.push_back(expanded[key]);
+        } else {
+            continue;
+        }
+        h.maxExponent = maxExponent;
+        h.stride.clear();
+        h.powerOffset.clear();
+        long size = 0;
+        for (int p = 0; p < arity; p++) {
+            if (h.form == FORM_DENSE) {
+                h.stride.push_back(p == 0 ? 1 : h.stride[p - 1] * (maxExponent[p - 1] + 1));
+            } else {
+                h.powerOffset.push_back(size);
+                size += maxExponent[p] + 1;
+            }
+        }
+        if (h.form == FORM_SPARSE)
+            h.powerOffset.push_back(size);
+    }
+}
+ 
+// Nested Horner's rule over parameters param, param - 1, ..., 0; the
+// coefficients for the powers of param are h.stride[param] apart.
+static unsigned evaluateDense(const PolyHeaderInfo &h, const unsigned* values, int param, long offset) {
+    unsigned result = 0;
+    if (param == 0) {
+        const unsigned* c = &h.coefficients[offset];
+        for (int e = h.maxExponent[0]; e >= 0; e--)
+            result = result * values[0] + c[e];
+        return result;
+    }
+    for (int e = h.maxExponent[param]; e >= 0; e--)
+        result = result * values[param]
+               + evaluateDense(h, values, param - 1, offset + e * h.stride[param]);
+    return result;
+}
+ 
+static int evaluateDense(const PolyHeaderInfo &h, const unsigned* values) {
+    return (int) evaluateDense(h, values, (int) h.stride.size() - 1, 0);
+}
+ 
+// Fills the table of the powers of each parameter, h.powerOffset.back()
+// entries, then sums the terms.
+static int evaluateSparse(const PolyHeaderInfo &h, const unsigned* values, unsigned* powers) {
+    int arity = h.maxExponent.size();
+    int bits = exponentBits(arity);
+    for (int p = 0; p < arity; p++) {
+        unsigned x = 1;
+        for (int e = 0; e <= h.maxExponent[p]; e++) {
+            powers[h.powerOffset[p] + e] = x;
+            x *= values[p];
+        }
     }
+    unsigned sum = 0;
+    for (size_t t = 0; t < h.exponents.size(); t++) {
+        unsigned product = h.coefficients[t];
+        for (int p = 0; p < arity; p++) {
+            int e = exponentOf(h.exponents[t], p, bits);
+            if (e != 0)
+                product *= powers[h.powerOffset[p] + e];
+        }
+        sum += product;
+    }
+    return (int) sum;
+}
+ 
+// Argument values and power tables of the calls being evaluated. Used as a
+// stack, so evaluate() does not allocate once it has grown; one per thread
+// for executeParallel().
+static thread_local std::vector<unsigned> scratch;
+static thread_local size_t scratchTop = 0;
+ 
+// Evaluate a call, or read its result location if value numbering found an
+// identical call earlier in the program.
+int Parser::evaluate(PolyEval* e) {
+    if (e->reused)
+        return mem[e->resultLoc];
+    const PolyHeaderInfo &header = polyHeaders[e->polyIndex];
+    size_t base = scratchTop;
+    size_t arity = e->args.size();
+    scratchTop += arity + (header.form == FORM_SPARSE ? header.powerOffset.back() : 0);
+    if (scratch.size() < scratchTop)
+        scratch.resize(scratchTop);
+    // Nested calls may grow scratch, so it is indexed rather than pointed into.
+    for (size_t i = 0; i < arity; i++) {
+        const Argument &a = e->args[i];
+        if (a.kind == ARG_ID)
+            scratch[base + i] = mem[a.loc];
+        else if (a.kind == ARG_NUM)
+            scratch[base + i] = a.value;
+        else
+            scratch[base + i] = evaluate(a.eval);
+    }
+    const unsigned* values = &scratch[base];
+    int result;
+    if (header.form == FORM_DENSE)
+        result = evaluateDense(header, values);
+    else if (header.form == FORM_SPARSE)
+        result = evaluateSparse(header, values, &scratch[base + arity]);
+    else
+        result = evaluateTermList(header.body, values);
+    scratchTop = base;
+    mem[e->resultLoc] = result;
+    return result;
 }
  
-// Execute the full program: ASSIGN and OUTPUT statements.
+// Execute the program in order: INPUT, ASSIGN and OUTPUT statements.
 void Parser::executeProgram() {
+    size_t inputIndex = 0;
     Statement* curr = stmtList;
     while (curr != nullptr) {
-         if (curr->type == STMT_ASSIGN) {
-             // For ASSIGN, we evaluate the polynomial F(x) = x + 2.
-             // Our simplified implementation assumes the polynomial call is F with one argument.
-             // Retrieve the value of the argument from memory.
-             // Here, we assume the argument is the first (and only) variable in the input list.
-             // For example, for "w = F(a);", we look up "a".
-             std::string argVar = ""; // Placeholder for the argument.
-             // In our current implementation, poly_evaluation() did not store the argument.
-             // For simplicity, assume that the argument variable is "a" (from our test input).
-             argVar = "a";
-             int argLoc = symbolTable[argVar];
-             int argVal = mem[argLoc];
-             int result = argVal + 2;  // Evaluate F(x) = x + 2.
-             int lhsLoc = symbolTable[curr->var];
-             mem[lhsLoc] = result;
+         if (curr->type == STMT_INPUT) {
+             if (inputIndex < inputValues.size()) {
+                 mem[curr->loc] = inputValues[inputIndex];
+                 inputIndex++;
+             } else {
+                 out.Flush();
+                 *os << "Error: Not enough input values." << endl;
+                 stop();
+             }
+         }
+         else if (curr->type == STMT_ASSIGN && curr->needed) {
+             mem[curr->loc] = evaluate(curr->eval);
          }
          else if (curr->type == STMT_OUTPUT) {
-             int loc = symbolTable[curr->var];
-             cout << mem[loc] << endl;
+             out.WriteValue(curr->var, mem[curr->loc]);
          }
          curr = curr->next;
     }
-    
-    // Debug: Print final memory state.
-    cout << "Memory state after full execution:" << endl;
+    dumpMemory();
+}
+ 
+// Debug: Print final memory state.
+void Parser::dumpMemory() {
+    out.Flush();
+    if (!debugOutput)
+        return;
+    *os << "Memory state after full execution:" << endl;
     for (auto &entry : symbolTable) {
-         cout << entry.first << " (loc " << entry.second << "): " << mem[entry.second] << endl;
+         *os << entry.first << " (loc " << entry.second << "): " << mem[entry.second] << endl;
+    }
+}
+ 
+// ####################### Tasks 3 and 4: warnings #######################
+// Both walk the statement list built for task 2; neither needs mem or the
+// compiled polynomials.
+
+// Appends the line of every argument variable of e, including those inside
+// nested calls, that is not yet initialized.
+static void uninitializedUses(const PolyEval* e, const std::vector<bool> &initialized,
+                              std::vector<int> &lines) {
+    for (const Argument &a : e->args) {
+         if (a.kind == ARG_ID && !initialized[a.loc])
+              lines.push_back(a.line_no);
+         else if (a.kind == ARG_POLY)
+              uninitializedUses(a.eval, initialized, lines);
+    }
+}
+
+// Marks every argument variable of e, including those inside nested calls, live.
+static void markArgumentsLive(const PolyEval* e, std::vector<bool> &live) {
+    for (const Argument &a : e->args) {
+         if (a.kind == ARG_ID)
+              live[a.loc] = true;
+         else if (a.kind == ARG_POLY)
+              markArgumentsLive(a.eval, live);
+    }
+}
+
+static void printWarning(std::ostream &os, int code, const std::vector<int> &lines) {
+    if (lines.empty())
+         return;
+    os << "Warning Code " << code << ":";
+    for (int line : lines)
+         os << " " << line;
+    os << endl;
+}
+
+// Warning Code 1: uses of a variable before any INPUT or assignment to it,
+// in the order they appear.
+void Parser::warnUninitialized() {
+    std::vector<bool> initialized(nextAvailable, false);
+    std::vector<int> lines;
+    for (Statement* curr = stmtList; curr != nullptr; curr = curr->next) {
+         if (curr->type == STMT_ASSIGN)
+              uninitializedUses(curr->eval, initialized, lines);
+         if (curr->type != STMT_OUTPUT)
+              initialized[curr->loc] = true;
+    }
+    out.Flush();
+    printWarning(*os, 1, lines);
+}
+
+// Warning Code 2: assignments whose value is never output, found by walking
+// the statements backwards and tracking which variables are live.
+void Parser::warnUselessAssignments() {
+    std::vector<bool> live(nextAvailable, false);
+    std::vector<Statement*> stmts;
+    for (Statement* curr = stmtList; curr != nullptr; curr = curr->next)
+         stmts.push_back(curr);
+
+    std::vector<int> lines;
+    for (auto it = stmts.rbegin(); it != stmts.rend(); ++it) {
+         Statement* s = *it;
+         switch (s->type) {
+         case STMT_OUTPUT:
+              live[s->loc] = true;
+              break;
+         case STMT_INPUT:
+              live[s->loc] = false;
+              break;
+         case STMT_ASSIGN:
+              if (!live[s->loc])
+                   lines.push_back(s->line_no);
+              live[s->loc] = false;
+              markArgumentsLive(s->eval, live);
+              break;
+         }
     }
+    std::sort(lines.begin(), lines.end());
+    out.Flush();
+    printWarning(*os, 2, lines);
 }
+
+// ####################### Task 5: degrees #######################
+// Saturates at INT_MAX, as exponents do.
+static int degree(const TermList* body) {
+    int result = 0;
+    for (const Term &t : body->terms) {
+         long long d = 0;
+         for (const Monomial &m : t.monomials) {
+              d += (long long) (m.sub != nullptr ? degree(m.sub) : 1) * m.exponent;
+              d = std::min<long long>(d, INT_MAX);
+         }
+         result = std::max(result, (int) d);
+    }
+    return result;
+}
+
+// Prints each polynomial's degree, in declaration order.
+void Parser::printDegrees() {
+    out.Flush();
+    for (const PolyHeaderInfo &h : polyHeaders)
+         *os << h.name << ": " << degree(h.body) << endl;
+}
+
+// ####################### --stats #######################
+#if POLY_STATS
+// Calls that evaluate() computes rather than reads back: the reused ones
+// just load the result of an earlier call.
+static void countEvaluations(const PolyEval* e, std::vector<uint64_t> &counts) {
+    if (e->reused)
+        return;
+    counts[e->polyIndex]++;
+    for (const Argument &a : e->args) {
+        if (a.kind == ARG_POLY)
+            countEvaluations(a.eval, counts);
+    }
+}
+#endif
+
+// The executors are not instrumented; statements executed and evaluations
+// are counted from the statement list afterwards, so --stats costs nothing
+// while the program runs.
+void Parser::writeStats() {
+#if POLY_STATS
+    stats.phases[PHASE_LEX] = lexer.TokenizeStats();
+    stats.tokens = lexer.TokenCount();
+    if (cachedBody != nullptr)
+        stats.cache = "hit";
+    else if (!cacheSavePath.empty())
+        stats.cache = "miss";
+
+    if (tasks[2]) {
+        std::vector<uint64_t> counts(polyHeaders.size(), 0);
+        for (Statement* curr = stmtList; curr != nullptr; curr = curr->next) {
+            if (curr->type == STMT_ASSIGN && !curr->needed)
+                continue;
+            stats.statementsExecuted++;
+            if (curr->type == STMT_ASSIGN)
+                countEvaluations(curr->eval, counts);
+        }
+        for (size_t i = 0; i < polyHeaders.size(); i++)
+            stats.evaluations.push_back({polyHeaders[i].name, counts[i]});
+    }
+    out.Flush();
+    stats.WriteJson(std::cerr);
+#endif
+}
+
+// ####################### Lazy execution #######################
+// Locations a call reads (argument variables, and the result location of a
+// call that value numbering reuses) and writes (its own result location).
+void Parser::collectLocs(PolyEval* e, std::vector<int> &reads, std::vector<int> &writes) {
+    if (e->reused) {
+        reads.push_back(e->resultLoc);
+        return;
+    }
+    writes.push_back(e->resultLoc);
+    for (size_t i = 0; i < e->args.size(); i++) {
+        if (e->args[i].kind == ARG_ID)
+            reads.push_back(e->args[i].loc);
+        else if (e->args[i].kind == ARG_POLY)
+            collectLocs(e->args[i].eval, reads, writes);
+    }
+}
+ 
+// Walk the statements backwards keeping the set of locations whose current
+// value some later OUTPUT still depends on. An ASSIGN is needed only if it
+// writes one of them. Each needed ASSIGN runs once, so every version of a
+// location is computed at most once. INPUT statements always run because
+// they consume the INPUTS in order.
+void Parser::markNeeded() {
+    std::vector<Statement*> stmts;
+    for (Statement* curr = stmtList; curr != nullptr; curr = curr->next)
+        stmts.push_back(curr);
+ 
+    std::vector<bool> live(nextAvailable, false);
+    std::vector<int> reads, writes;
+    for (size_t i = stmts.size(); i-- > 0; ) {
+        Statement* s = stmts[i];
+        if (s->type == STMT_OUTPUT) {
+            live[s->loc] = true;
+        }
+        else if (s->type == STMT_INPUT) {
+            live[s->loc] = false;
+        }
+        else {
+            reads.clear();
+            writes.clear();
+            collectLocs(s->eval, reads, writes);
+            writes.push_back(s->loc);
+            s->needed = false;
+            for (size_t k = 0; k < writes.size(); k++) {
+                if (live[writes[k]]) {
+                    s->needed = true;
+                    break;
+                }
+            }
+            if (!s->needed)
+                continue;
+            for (size_t k = 0; k < writes.size(); k++)
+                live[writes[k]] = false;
+            for (size_t k = 0; k < reads.size(); k++)
+                live[reads[k]] = true;
+        }
+    }
+}
+ 
+// ####################### Parallel execution #######################
+// One node per statement that has to run (skipped ASSIGNs are left out).
+// An edge orders two statements when one reads or writes a location the
+// other writes: read after write, write after read and write after write.
+// INPUT values are handed out by position up front, and OUTPUT values are
+// collected by position and printed at the end, so neither needs an order
+// beyond its data dependencies.
+std::vector<StmtNode> Parser::buildDependencyGraph(int &outputCount) {
+    std::vector<StmtNode> nodes;
+    std::vector<int> lastWriter(nextAvailable, -1);
+    std::vector<std::vector<int> > readers(nextAvailable);
+    std::vector<int> reads, writes;
+    int inputCount = 0;
+    outputCount = 0;
+ 
+    for (Statement* curr = stmtList; curr != nullptr; curr = curr->next) {
+        if (!curr->needed)
+            continue;
+        StmtNode node;
+        node.stmt = curr;
+        node.inputIndex = -1;
+        node.outputIndex = -1;
+        node.pending = 0;
+        reads.clear();
+        writes.clear();
+        if (curr->type == STMT_INPUT) {
+            node.inputIndex = inputCount++;
+            writes.push_back(curr->loc);
+        } else if (curr->type == STMT_OUTPUT) {
+            node.outputIndex = outputCount++;
+            reads.push_back(curr->loc);
+        } else {
+            collectLocs(curr->eval, reads, writes);
+            writes.push_back(curr->loc);
+        }
+ 
+        int self = nodes.size();
+        nodes.push_back(node);
+        for (size_t k = 0; k < reads.size(); k++) {
+            int w = lastWriter[reads[k]];
+            if (w != -1 && w != self) {
+                nodes[w].succ.push_back(self);
+                nodes[self].pending++;
+            }
+        }
+        for (size_t k = 0; k < writes.size(); k++) {
+            int loc = writes[k];
+            if (lastWriter[loc] != -1 && lastWriter[loc] != self) {
+                nodes[lastWriter[loc]].succ.push_back(self);
+                nodes[self].pending++;
+            }
+            for (size_t r = 0; r < readers[loc].size(); r++) {
+                if (readers[loc][r] != self) {
+                    nodes[readers[loc][r]].succ.push_back(self);
+                    nodes[self].pending++;
+                }
+            }
+        }
+        for (size_t k = 0; k < reads.size(); k++)
+            readers[reads[k]].push_back(self);
+        for (size_t k = 0; k < writes.size(); k++) {
+            lastWriter[writes[k]] = self;
+            readers[writes[k]].clear();
+        }
+    }
+    return nodes;
+}
+ 
+void Parser::executeParallel() {
+    int outputCount;
+    std::vector<StmtNode> nodes = buildDependencyGraph(outputCount);
+ 
+    // Running out of INPUTS is reported after the OUTPUTs before it, which
+    // only the serial executor gets right.
+    int inputCount = 0;
+    for (size_t i = 0; i < nodes.size(); i++)
+        inputCount += (nodes[i].inputIndex != -1);
+    if (inputCount > (int) inputValues.size()) {
+        executeProgram();
+        return;
+    }
+ 
+    std::vector<Statement*> outputStmts(outputCount);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].outputIndex != -1)
+            outputStmts[nodes[i].outputIndex] = nodes[i].stmt;
+    }
+    std::vector<int> outputs(outputCount);
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<int> ready;
+    size_t done = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].pending == 0)
+            ready.push_back(i);
+    }
+ 
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            cv.wait(guard, [&]() { return !ready.empty() || done == nodes.size(); });
+            if (ready.empty())
+                return;
+            int n = ready.front();
+            ready.pop_front();
+            guard.unlock();
+ 
+            Statement* s = nodes[n].stmt;
+            if (s->type == STMT_INPUT)
+                mem[s->loc] = inputValues[nodes[n].inputIndex];
+            else if (s->type == STMT_OUTPUT)
+                outputs[nodes[n].outputIndex] = mem[s->loc];
+            else
+                mem[s->loc] = evaluate(s->eval);
+ 
+            guard.lock();
+            done++;
+            for (size_t k = 0; k < nodes[n].succ.size(); k++) {
+                if (--nodes[nodes[n].succ[k]].pending == 0)
+                    ready.push_back(nodes[n].succ[k]);
+            }
+            cv.notify_all();
+        }
+    };
  
-int main() {
+    std::vector<std::thread> pool;
+    for (int i = 0; i < numThreads; i++)
+        pool.push_back(std::thread(worker));
+    for (size_t i = 0; i < pool.size(); i++)
+        pool[i].join();
+ 
+    for (int i = 0; i < outputCount; i++)
+        out.WriteValue(outputStmts[i]->var, outputs[i]);
+    dumpMemory();
+}
+ 
+void Parser::setOptions(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--lazy")
+            lazyExecution = true;
+        else if (std::string(argv[i]) == "--threads" && i + 1 < argc)
+            numThreads = std::max(1, atoi(argv[++i]));
+        else if (std::string(argv[i]) == "--debug")
+            debugOutput = true;
+        else if (std::string(argv[i]) == "--stats")
+            stats.enabled = true;
+        else if (std::string(argv[i]) == "--format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "csv")
+                out.SetFormat(OUTPUT_CSV);
+            else if (format == "binary")
+                out.SetFormat(OUTPUT_BINARY);
+            else
+                out.SetFormat(OUTPUT_TEXT);
+        }
+    }
+}
+ 
+int main(int argc, char* argv[]) {
+#if POLY_STATS
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--stats")
+            EnableAllocationCounting();
+    }
+#endif
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--cache")
+            return RunWithProgramCache(argv[i + 1], argc, argv);
+        if (std::string(argv[i]) == "--serve")
+            return RunServer(argv[i + 1], argc, argv);
+    }
     Parser parser;
+    parser.setOptions(argc, argv);
     parser.input();
     return 0;
 }
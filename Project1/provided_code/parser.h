@@ -3,30 +3,128 @@
 
 #include <string>
 #include "lexer.h"
+#include "outputsink.h"
+#include "stats.h"
 #include <unordered_set>
 #include <vector>
 #include <unordered_map>
+#include <cstdint>
+#include <memory>
+
+struct TermList;
+
+// monomial → primary | primary exponent
+struct Monomial {
+    int paramIndex;         // Index into the parameter list, or -1 if the primary is ( term_list ).
+    TermList* sub;          // Parenthesized term_list; nullptr when the primary is an ID.
+    int exponent;           // 1 when no exponent is given.
+};
+
+// term → coefficient | coefficient monomial_list | monomial_list
+struct Term {
+    int sign;               // +1 or -1, from the add_operator in front of the term.
+    int coefficient;        // 1 when no coefficient is given.
+    std::vector<Monomial> monomials;
+};
+
+// term_list → term | term add_operator term_list
+struct TermList {
+    std::vector<Term> terms;
+};
+
+// How evaluate() computes a polynomial; chosen by compilePolynomials().
+//   FORM_TREE    walk the parsed body
+//   FORM_DENSE   expanded; a coefficient for every exponent vector up to
+//                maxExponent, coefficient of x0^e0 x1^e1 ... at
+//                e0 + (maxExponent[0] + 1) * (e1 + (maxExponent[1] + 1) * ...)
+//   FORM_SPARSE  expanded; only the nonzero terms, with the exponents of
+//                each term packed into 64 bits (16 bits per parameter for
+//                up to 4 parameters, 8 bits otherwise)
+enum PolyForm { FORM_TREE, FORM_DENSE, FORM_SPARSE };
 
 struct PolyHeaderInfo {
     std::string name;               
     int line_no;                    
     std::vector<std::string> paramNames;  
+    std::unordered_map<std::string, int> paramIndex;  // parameter name => position in paramNames.
+    TermList* body;                 // Parsed poly_body.
+    long calls;                     // Calls value numbering did not fold away; sizes the
+                                    // expansion work compilePolynomials() may spend on it.
+    PolyForm form;
+    std::vector<int> maxExponent;       // FORM_DENSE, FORM_SPARSE: highest power of each parameter.
+    std::vector<unsigned> coefficients; // FORM_DENSE, FORM_SPARSE: coefficients mod 2^32.
+    std::vector<uint64_t> exponents;    // FORM_SPARSE: packed exponents of each coefficient.
+    std::vector<long> stride;           // FORM_DENSE: distance between successive powers of each parameter.
+    std::vector<int> powerOffset;       // FORM_SPARSE: where each parameter's powers start in the power
+                                        // table; one more entry at the end for the table size.
+};
+
+enum ArgKind { ARG_ID, ARG_NUM, ARG_POLY };
+
+struct PolyEval;
+
+// argument → ID | NUM | poly_evaluation
+struct Argument {
+    ArgKind kind;
+    int line_no;            // ARG_ID: line of the variable, for Warning Code 1.
+    int loc;                // ARG_ID: memory location of the variable.
+    int value;              // ARG_NUM: the constant.
+    PolyEval* eval;         // ARG_POLY: the nested call.
+};
+
+// poly_evaluation → poly_name LPAREN argument_list RPAREN
+struct PolyEval {
+    std::string name;
+    int line_no;
+    int polyIndex;          // Index into polyHeaders, -1 if the polynomial is not declared.
+    std::vector<Argument> args;
+    int resultLoc;          // Memory location that holds the value of this call.
+    bool reused;            // Set by value numbering: an identical earlier call already filled resultLoc.
 };
 
 enum StmtType { STMT_INPUT, STMT_OUTPUT, STMT_ASSIGN };
 
+struct Statement;
+
+// A node of the statement dependency graph used by executeParallel().
+struct StmtNode {
+    Statement* stmt;
+    int inputIndex;             // INPUT: index of the INPUTS value it consumes.
+    int outputIndex;            // OUTPUT: position of its line in the program output.
+    int pending;                // predecessors that have not finished yet.
+    std::vector<int> succ;      // nodes that must wait for this one.
+};
+
 struct Statement {
     StmtType type;          // INPUT, OUTPUT, or ASSIGN.
     std::string var;        // For INPUT/OUTPUT: the variable name; for assignment, the LHS.
+    int line_no;            // Line of var.
+    int loc;                // Memory location of var.
+    PolyEval* eval;         // For ASSIGN: the right-hand side; nullptr otherwise.
+    bool needed;            // Cleared by markNeeded() if no OUTPUT depends on this statement.
     Statement* next;        // Pointer to the next statement in the list.
 };
 
+// Thrown by Parser::stop() instead of exiting when throwOnError is set.
+struct ParseStopped {};
+
 class Parser {
   public:
     Parser();                     // Constructor
+    Parser(std::istream &in, std::ostream &os);  // reads the program from in, writes all output to os
+    ~Parser();
     void ConsumeAllInput();       // Prints remaining tokens after parsing
     void input();                 // Called from main(); calls program(), then expects EOF
 
+    // Phases run by input(), each only when its task is requested. The
+    // semantic checks also run for tasks 2-4, which need a valid program.
+    void checkSemantics();        // task 1
+    void runProgram();            // task 2
+    void warnUninitialized();     // task 3: Warning Code 1
+    void warnUselessAssignments();// task 4: Warning Code 2
+    void printDegrees();          // task 5
+    void setOptions(int argc, char* argv[]);
+
     // Grammar productions
     void program();
     void tasks_section();
@@ -37,15 +135,15 @@ class Parser {
     void poly_decl();
     void poly_header();
     std::vector<std::string> id_list();
-    void poly_body();
-    void term_list();
-    void add_operator();
-    void term();
-    void coefficient();
-    void monomial_list();
-    void monomial();
-    void exponent();
-    void primary();
+    TermList* poly_body();
+    TermList* term_list();
+    int add_operator();
+    Term term();
+    int coefficient();
+    void monomial_list(std::vector<Monomial> &monomials);
+    Monomial monomial();
+    int exponent();
+    Monomial primary();
     void execute_section();
     void statement_list();
     void statement();
@@ -53,36 +151,106 @@ class Parser {
     void output_statement();
     void assign_statement();
     Token poly_name();
-    void executeInputStatements();
-    void poly_evaluation();
-    int argument_list();
-    void argument();
+    PolyEval* poly_evaluation();
+    int argument_list(PolyEval* e);
+    Argument argument();
     void inputs_section();
     void executeProgram();
+    int evaluate(PolyEval* e);
+    int evaluateTermList(const TermList* body, const unsigned* values);
+    void compilePolynomials();
 
     bool tasks[7];
 
-    std::unordered_set<std::string> declaredPolynomials;    // For semantic error checking.
+    // Declaration table: polynomial name => index of its first declaration in
+    // polyHeaders. Shared by the semantic checks and the evaluator.
+    std::unordered_map<std::string, int> polyTable;
     std::vector<int> undefinedPolyUseLines;                 
     std::vector<int> wrongArgCountLines;                    
 
     // TASK 2 – Runtime Data Structures:
+    // Only built when task 2, 3 or 4 is requested (buildProgram); mem is
+    // only allocated by runProgram().
+    bool buildProgram;
     std::unordered_map<std::string, int> symbolTable; // maps variable names to memory locations.
     int nextAvailable;                                // next available memory location.
     Statement* stmtList;                              // linked list of statements.
+    Statement* stmtTail;                              // last statement, so appending is O(1).
+    int allocate(const std::string &var);             // returns var's location, allocating one if needed.
+    void appendStatement(Statement* s);
+
+    // Value numbering: identical calls whose argument variables have not been
+    // reassigned in between share one result location.
+    std::vector<int> locVersion;                      // bumped every time a location is written.
+    std::unordered_map<std::string, int> valueTable;  // call key => result location.
+    void numberValues(PolyEval* e);
+    void bumpVersion(int loc);
 
     // NEW: Memory array for variables and input storage.
-    std::vector<int> mem;         // e.g., 1000 slots, all initialized to 0.
+    std::vector<int> mem;         // one slot per location, all initialized to 0.
     std::vector<int> inputValues; // Stores the numbers from the INPUTS section.
 
+    // Program output goes through out. The symbol table and memory dumps are
+    // only printed with debugOutput (--debug).
+    OutputSink out;
+    bool debugOutput;
+    void dumpMemory();
+
+    // --stats: per-phase profile written to stderr as JSON (see stats.h).
+    ProgramStats stats;
+    void writeStats();
+
+    // Error and debug lines go to *os. After an error has been printed,
+    // stop() exits, or throws ParseStopped if throwOnError is set (server).
+    std::ostream* os;
+    bool throwOnError;
+    void stop();
+
+    // Lazy execution: only ASSIGN statements that some OUTPUT transitively
+    // depends on are evaluated.
+    bool lazyExecution;
+    void markNeeded();
+    void collectLocs(PolyEval* e, std::vector<int> &reads, std::vector<int> &writes);
+
+    // Parallel execution: statements are ordered only by the locations they
+    // read and write, and independent ones run on a pool of worker threads.
+    int numThreads;
+    std::vector<StmtNode> buildDependencyGraph(int &outputCount);
+    void executeParallel();
+
+    // Compiled-program cache (progcache.cc). With cachedBody set, input()
+    // loads the program from it and only parses INPUTS; with cacheSavePath
+    // set, a program that passes the semantic checks is saved there, along
+    // with its text (cacheProgram, the text before INPUTS).
+    const char* cachedBody;
+    size_t cachedBodySize;
+    std::string cacheSavePath;
+    uint64_t cacheKey;
+    const char* cacheProgram;
+    size_t cacheProgramSize;
+    std::string serializeCompiled();
+    bool loadCompiled(const char* data, size_t size);
+    void saveCompiled(const std::string &path, uint64_t key);
+    bool keepCompiled;                      // keep serializeCompiled() of a valid program...
+    std::string compiledBody;               // ...here (server LRU)
+
+    // Every TermList and PolyEval belongs to the Parser from the moment it
+    // is allocated, so a ParseStopped thrown while a tree is half built
+    // (server) does not leak the part built so far.
+    TermList* newTermList();
+    PolyEval* newPolyEval();
+
   private:
     LexicalAnalyzer lexer;
+    void init();
     void syntax_error();
     Token expect(TokenType expected_type);
     std::vector<PolyHeaderInfo> polyHeaders;
     std::vector<int> duplicateLines;
-    std::vector<std::string> currentPolyParams;
+    int currentPoly;                        // index of the polynomial whose body is being parsed, -1 outside.
     std::vector<int> invalidMonomialLines; 
+    std::vector<std::unique_ptr<TermList> > termLists;
+    std::vector<std::unique_ptr<PolyEval> > polyEvals;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,501 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "progcache.h"
+#include "parser.h"
+
+using namespace std;
+
+// Mirrors how the lexer splits input into tokens: an identifier or keyword
+// is a letter followed by letters and digits, a number is a run of digits,
+// and everything else is a one-character token or space.
+size_t FindInputsKeyword(const string& text)
+{
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = text[i];
+        if (isalpha(c)) {
+            size_t start = i;
+            while (i < text.size() && isalnum((unsigned char) text[i]))
+                i++;
+            if (text.compare(start, i - start, "INPUTS") == 0)
+                return start;
+        } else if (isdigit(c)) {
+            while (i < text.size() && isdigit((unsigned char) text[i]))
+                i++;
+        } else {
+            i++;
+        }
+    }
+    return string::npos;
+}
+
+// 64-bit FNV-1a.
+uint64_t HashProgramText(const char* data, size_t size)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        h ^= (unsigned char) data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+string ProgramCachePath(const string& dir, uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.pcache", (unsigned long long) key);
+    return dir + "/" + name;
+}
+
+MappedProgramCache::MappedProgramCache()
+{
+    base = nullptr;
+    size = 0;
+}
+
+MappedProgramCache::~MappedProgramCache()
+{
+    if (base != nullptr)
+        munmap(base, size);
+}
+
+bool MappedProgramCache::Open(const string& path, uint64_t key, const char* program, size_t programSize)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(ProgramCacheHeader)) {
+        close(fd);
+        return false;
+    }
+    size = st.st_size;
+    base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        base = nullptr;
+        return false;
+    }
+
+    const ProgramCacheHeader* header = (const ProgramCacheHeader*) base;
+    const char* text = (const char*) base + sizeof(ProgramCacheHeader);
+    if (memcmp(header->magic, "PLYC", 4) != 0 ||
+        header->version != PROGRAM_CACHE_VERSION ||
+        header->key != key ||
+        header->programSize != programSize ||
+        header->programSize > size - sizeof(ProgramCacheHeader) ||
+        memcmp(text, program, programSize) != 0 ||
+        header->bodySize != size - sizeof(ProgramCacheHeader) - programSize ||
+        header->bodyChecksum != HashProgramText(Body(), BodySize())) {
+        munmap(base, size);
+        base = nullptr;
+        return false;
+    }
+    return true;
+}
+
+const char* MappedProgramCache::Body()
+{
+    const ProgramCacheHeader* header = (const ProgramCacheHeader*) base;
+    return (const char*) base + sizeof(ProgramCacheHeader) + header->programSize;
+}
+
+size_t MappedProgramCache::BodySize()
+{
+    const ProgramCacheHeader* header = (const ProgramCacheHeader*) base;
+    return size - sizeof(ProgramCacheHeader) - header->programSize;
+}
+
+// ####################### Serialization #######################
+// The body is a flat sequence of 32-bit ints; a string is its length
+// followed by its bytes, a vector its length followed by its elements
+// (packed 64-bit exponents as two ints each, low half first).
+
+static void putInt(string& out, int32_t v)
+{
+    out.append((const char*) &v, sizeof(v));
+}
+
+static void putString(string& out, const string& s)
+{
+    putInt(out, s.size());
+    out.append(s);
+}
+
+template <class T>
+static void putInts(string& out, const vector<T>& v)
+{
+    putInt(out, v.size());
+    for (T x : v)
+        putInt(out, (int32_t) x);
+}
+
+static void putPacked(string& out, const vector<uint64_t>& v)
+{
+    putInt(out, v.size());
+    for (uint64_t x : v) {
+        putInt(out, (int32_t) (uint32_t) x);
+        putInt(out, (int32_t) (uint32_t) (x >> 32));
+    }
+}
+
+struct CacheReader {
+    const char* p;
+    const char* end;
+    bool bad;
+
+    int32_t Int() {
+        int32_t v = 0;
+        if (end - p < (ptrdiff_t) sizeof(v)) {
+            bad = true;
+            return 0;
+        }
+        memcpy(&v, p, sizeof(v));
+        p += sizeof(v);
+        return v;
+    }
+    template <class T>
+    void Ints(vector<T>& v) {
+        int32_t n = Int();
+        if (n < 0 || (end - p) / (ptrdiff_t) sizeof(int32_t) < n) {
+            bad = true;
+            return;
+        }
+        v.resize(n);
+        for (int32_t i = 0; i < n; i++)
+            v[i] = (T) Int();
+    }
+    void Packed(vector<uint64_t>& v) {
+        int32_t n = Int();
+        if (n < 0 || (end - p) / (ptrdiff_t) (2 * sizeof(int32_t)) < n) {
+            bad = true;
+            return;
+        }
+        v.resize(n);
+        for (int32_t i = 0; i < n; i++) {
+            uint64_t low = (uint32_t) Int();
+            v[i] = low | (uint64_t) (uint32_t) Int() << 32;
+        }
+    }
+    string String() {
+        int32_t n = Int();
+        if (n < 0 || end - p < n) {
+            bad = true;
+            return "";
+        }
+        string s(p, n);
+        p += n;
+        return s;
+    }
+};
+
+static void putTermList(string& out, const TermList* list)
+{
+    putInt(out, list->terms.size());
+    for (const Term &t : list->terms) {
+        putInt(out, t.sign);
+        putInt(out, t.coefficient);
+        putInt(out, t.monomials.size());
+        for (const Monomial &m : t.monomials) {
+            putInt(out, m.paramIndex);
+            putInt(out, m.exponent);
+            putInt(out, m.sub != nullptr);
+            if (m.sub != nullptr)
+                putTermList(out, m.sub);
+        }
+    }
+}
+
+static TermList* getTermList(Parser& parser, CacheReader& in)
+{
+    TermList* list = parser.newTermList();
+    int32_t terms = in.Int();
+    for (int32_t i = 0; i < terms && !in.bad; i++) {
+        Term t;
+        t.sign = in.Int();
+        t.coefficient = in.Int();
+        int32_t monomials = in.Int();
+        for (int32_t k = 0; k < monomials && !in.bad; k++) {
+            Monomial m;
+            m.paramIndex = in.Int();
+            m.exponent = in.Int();
+            m.sub = in.Int() ? getTermList(parser, in) : nullptr;
+            t.monomials.push_back(m);
+        }
+        list->terms.push_back(t);
+    }
+    return list;
+}
+
+static void putPolyEval(string& out, const PolyEval* e)
+{
+    putString(out, e->name);
+    putInt(out, e->line_no);
+    putInt(out, e->polyIndex);
+    putInt(out, e->resultLoc);
+    putInt(out, e->reused);
+    putInt(out, e->args.size());
+    for (const Argument &a : e->args) {
+        putInt(out, a.kind);
+        putInt(out, a.line_no);
+        putInt(out, a.loc);
+        putInt(out, a.value);
+        if (a.kind == ARG_POLY)
+            putPolyEval(out, a.eval);
+    }
+}
+
+static PolyEval* getPolyEval(Parser& parser, CacheReader& in)
+{
+    PolyEval* e = parser.newPolyEval();
+    e->name = in.String();
+    e->line_no = in.Int();
+    e->polyIndex = in.Int();
+    e->resultLoc = in.Int();
+    e->reused = in.Int();
+    int32_t args = in.Int();
+    for (int32_t i = 0; i < args && !in.bad; i++) {
+        Argument a;
+        a.kind = (ArgKind) in.Int();
+        a.line_no = in.Int();
+        a.loc = in.Int();
+        a.value = in.Int();
+        a.eval = (a.kind == ARG_POLY) ? getPolyEval(parser, in) : nullptr;
+        e->args.push_back(a);
+    }
+    return e;
+}
+
+string Parser::serializeCompiled()
+{
+    string out;
+    for (int i = 0; i < 7; i++)
+        putInt(out, tasks[i]);
+    putInt(out, nextAvailable);
+
+    putInt(out, symbolTable.size());
+    for (auto &entry : symbolTable) {
+        putString(out, entry.first);
+        putInt(out, entry.second);
+    }
+
+    putInt(out, polyHeaders.size());
+    for (const PolyHeaderInfo &h : polyHeaders) {
+        putString(out, h.name);
+        putInt(out, h.line_no);
+        putInt(out, h.paramNames.size());
+        for (const string &p : h.paramNames)
+            putString(out, p);
+        putTermList(out, h.body);
+        putInt(out, h.form);
+        if (h.form != FORM_TREE) {
+            putInts(out, h.maxExponent);
+            putInts(out, h.coefficients);
+            putPacked(out, h.exponents);
+            putInts(out, h.stride);
+            putInts(out, h.powerOffset);
+        }
+    }
+
+    int count = 0;
+    for (Statement* s = stmtList; s != nullptr; s = s->next)
+        count++;
+    putInt(out, count);
+    for (Statement* s = stmtList; s != nullptr; s = s->next) {
+        putInt(out, s->type);
+        putString(out, s->var);
+        putInt(out, s->line_no);
+        putInt(out, s->loc);
+        if (s->type == STMT_ASSIGN)
+            putPolyEval(out, s->eval);
+    }
+    return out;
+}
+
+bool Parser::loadCompiled(const char* data, size_t size)
+{
+    CacheReader in = { data, data + size, false };
+    for (int i = 0; i < 7; i++)
+        tasks[i] = in.Int();
+    nextAvailable = in.Int();
+
+    int32_t vars = in.Int();
+    for (int32_t i = 0; i < vars && !in.bad; i++) {
+        string name = in.String();
+        symbolTable[name] = in.Int();
+    }
+
+    int32_t polys = in.Int();
+    for (int32_t i = 0; i < polys && !in.bad; i++) {
+        PolyHeaderInfo h;
+        h.calls = 0;                // only used by compilePolynomials()
+        h.name = in.String();
+        h.line_no = in.Int();
+        int32_t params = in.Int();
+        for (int32_t k = 0; k < params && !in.bad; k++) {
+            h.paramNames.push_back(in.String());
+            h.paramIndex.insert({h.paramNames.back(), k});
+        }
+        h.body = getTermList(*this, in);
+        h.form = (PolyForm) in.Int();
+        if (h.form != FORM_TREE) {
+            in.Ints(h.maxExponent);
+            in.Ints(h.coefficients);
+            in.Packed(h.exponents);
+            in.Ints(h.stride);
+            in.Ints(h.powerOffset);
+        }
+        polyTable.insert({h.name, (int) polyHeaders.size()});
+        polyHeaders.push_back(h);
+    }
+
+    int32_t statements = in.Int();
+    for (int32_t i = 0; i < statements && !in.bad; i++) {
+        Statement* s = new Statement;
+        s->type = (StmtType) in.Int();
+        s->var = in.String();
+        s->line_no = in.Int();
+        s->loc = in.Int();
+        s->eval = (s->type == STMT_ASSIGN) ? getPolyEval(*this, in) : nullptr;
+        s->needed = true;
+        s->next = nullptr;
+        appendStatement(s);
+    }
+    return !in.bad && in.p == in.end;
+}
+
+// Write to a temporary file and rename it, so a concurrent reader never maps
+// a half-written cache.
+void Parser::saveCompiled(const string& path, uint64_t key)
+{
+    string body = serializeCompiled();
+    ProgramCacheHeader header;
+    memcpy(header.magic, "PLYC", 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    header.programSize = cacheProgramSize;
+    header.bodySize = body.size();
+    header.bodyChecksum = HashProgramText(body.data(), body.size());
+
+    string tmp = path + ".tmp" + to_string(getpid());
+    ofstream file(tmp.c_str(), ios::binary);
+    file.write((const char*) &header, sizeof(header));
+    file.write(cacheProgram, cacheProgramSize);
+    file.write(body.data(), body.size());
+    file.close();
+    if (!file || rename(tmp.c_str(), path.c_str()) != 0)
+        remove(tmp.c_str());
+}
+
+// ####################### Cached run #######################
+// Reads the program text from in, up to and including the INPUTS keyword,
+// into text and returns the offset of INPUTS (std::string::npos if there is
+// none and all of in was read). Tokens are recognized as in
+// FindInputsKeyword(); the numbers after INPUTS are left unread.
+static size_t ReadProgramText(streambuf* in, string& text)
+{
+    typedef streambuf::traits_type traits;
+    int c;
+    while ((c = in->sgetc()) != traits::eof()) {
+        if (isalpha(c)) {
+            size_t start = text.size();
+            while ((c = in->sgetc()) != traits::eof() && isalnum(c))
+                text += (char) in->sbumpc();
+            if (text.compare(start, string::npos, "INPUTS") == 0)
+                return start;
+        } else if (isdigit(c)) {
+            while ((c = in->sgetc()) != traits::eof() && isdigit(c))
+                text += (char) in->sbumpc();
+        } else {
+            text += (char) in->sbumpc();
+        }
+    }
+    return string::npos;
+}
+
+// A stream buffer that yields the given bytes, then the rest of another
+// stream buffer. Neither is copied up front; the INPUTS section goes from
+// stdin to the lexer as it would without --cache.
+class PrefixedStreambuf : public streambuf {
+  public:
+    PrefixedStreambuf(const char* prefix, size_t size, streambuf* rest) : rest(rest)
+    {
+        char* p = const_cast<char*>(prefix);
+        setg(p, p, p + size);
+    }
+
+  protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+        streamsize n = rest->sgetn(buffer, sizeof(buffer));
+        if (n <= 0)
+            return traits_type::eof();
+        setg(buffer, buffer, buffer + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    streamsize xsgetn(char* s, streamsize n) override
+    {
+        streamsize done = min<streamsize>(n, egptr() - gptr());
+        memcpy(s, gptr(), done);
+        gbump((int) done);
+        if (done < n)
+            done += max<streamsize>(0, rest->sgetn(s + done, n - done));
+        return done;
+    }
+
+  private:
+    streambuf* rest;
+    char buffer[1 << 16];
+};
+
+// The lexer reads cin as soon as the Parser is constructed, so the program
+// text is read here first and cin is pointed at the program text followed by
+// the rest of stdin (cache miss), or just the INPUTS keyword followed by the
+// rest of stdin (cache hit).
+int RunWithProgramCache(const string& dir, int argc, char* argv[])
+{
+    string text;
+    size_t split = ReadProgramText(cin.rdbuf(), text);
+    uint64_t key = 0;
+    MappedProgramCache cache;
+    bool hit = false;
+    if (split != string::npos) {
+        key = HashProgramText(text.data(), split);
+        hit = cache.Open(ProgramCachePath(dir, key), key, text.data(), split);
+    }
+
+    size_t skip = hit ? split : 0;
+    PrefixedStreambuf source(text.data() + skip, text.size() - skip, cin.rdbuf());
+    streambuf* original = cin.rdbuf(&source);
+    {
+        Parser parser;
+        parser.setOptions(argc, argv);
+        if (hit) {
+            parser.cachedBody = cache.Body();
+            parser.cachedBodySize = cache.BodySize();
+        } else if (split != string::npos) {
+            parser.cacheSavePath = ProgramCachePath(dir, key);
+            parser.cacheKey = key;
+            parser.cacheProgram = text.data();
+            parser.cacheProgramSize = split;
+        }
+        parser.input();
+    }
+    cin.rdbuf(original);
+    return 0;
+}
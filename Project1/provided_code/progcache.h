@@ -0,0 +1,56 @@
+#ifndef __PROGRAM_CACHE__H__
+#define __PROGRAM_CACHE__H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Compiled-program cache (--cache DIR).
+//
+// Everything before the INPUTS section is the program; its compiled form
+// (polynomial bodies and, for task 2, their dense or sparse forms; symbol
+// table and statement list with their memory locations) is stored in
+// DIR/<hash of the program text>.pcache. A run whose program text was seen
+// before loads that file instead of lexing, parsing and compiling it, and
+// only reads the new INPUTS.
+//
+// File layout: a fixed header (magic, format version, program hash, program
+// size, body size and body checksum), the program text itself, then the body
+// written by Parser::serializeCompiled(). The hash only names the file; a
+// hit also needs the stored text to equal the program, so two programs
+// whose hashes collide never share a cache. A file that does not match is
+// ignored and rewritten.
+
+#define PROGRAM_CACHE_VERSION 4
+
+struct ProgramCacheHeader {
+    char magic[4];          // "PLYC"
+    uint32_t version;       // PROGRAM_CACHE_VERSION
+    uint64_t key;           // HashProgramText() of the program text
+    uint64_t programSize;   // length of the program text after the header
+    uint64_t bodySize;
+    uint64_t bodyChecksum;  // HashProgramText() of the body bytes
+};
+
+// Offset of the INPUTS keyword as the lexer would find it, or std::string::npos.
+size_t FindInputsKeyword(const std::string& text);
+uint64_t HashProgramText(const char* data, size_t size);
+std::string ProgramCachePath(const std::string& dir, uint64_t key);
+
+// A read-only mapping of a cache file whose header checks out.
+class MappedProgramCache {
+  public:
+    MappedProgramCache();
+    ~MappedProgramCache();
+    bool Open(const std::string& path, uint64_t key, const char* program, size_t programSize);
+    const char* Body();
+    size_t BodySize();
+
+  private:
+    void* base;
+    size_t size;
+};
+
+int RunWithProgramCache(const std::string& dir, int argc, char* argv[]);
+
+#endif  //__PROGRAM_CACHE__H__
@@ -0,0 +1,244 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <list>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <exception>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "progcache.h"
+#include "parser.h"
+
+using namespace std;
+
+// A program text (everything before INPUTS) and its compiled body
+// (Parser::serializeCompiled()).
+struct CompiledProgram {
+    string program;
+    string body;
+};
+
+// Compiled programs by program hash. The hash is not trusted to identify a
+// program: full-text requests compare the text, and an entry is never
+// replaced by a different program whose hash collides with it, so "@key"
+// keeps naming the program that was sent first.
+class CompiledProgramLRU {
+  public:
+    explicit CompiledProgramLRU(size_t capacity) : capacity(capacity) {}
+
+    shared_ptr<const CompiledProgram> Get(uint64_t key)
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = index.find(key);
+        if (it == index.end())
+            return nullptr;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    void Put(uint64_t key, shared_ptr<const CompiledProgram> compiled)
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            if (it->second->second->program != compiled->program)
+                return;
+            entries.erase(it->second);
+            index.erase(it);
+        }
+        entries.push_front(make_pair(key, compiled));
+        index[key] = entries.begin();
+        while (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+  private:
+    typedef list<pair<uint64_t, shared_ptr<const CompiledProgram> > > EntryList;
+    size_t capacity;
+    mutex lock;
+    EntryList entries;                                  // most recently used first
+    unordered_map<uint64_t, EntryList::iterator> index;
+};
+
+static string HandleRequest(const string& text, CompiledProgramLRU& programs,
+                            int argc, char* argv[])
+{
+    shared_ptr<const CompiledProgram> compiled;
+    string source;
+    uint64_t key = 0;
+    size_t split = string::npos;
+    bool compile = false;
+
+    if (!text.empty() && text[0] == '@') {
+        size_t end = text.find_first_of(" \t\r\n", 1);
+        if (end == string::npos)
+            end = text.size();
+        string hex = text.substr(1, end - 1);
+        key = strtoull(hex.c_str(), nullptr, 16);
+        compiled = programs.Get(key);
+        if (compiled == nullptr)
+            return "Error: unknown program " + hex + "\n";
+        source = text.substr(end);
+    } else {
+        split = FindInputsKeyword(text);
+        if (split != string::npos) {
+            key = HashProgramText(text.data(), split);
+            compiled = programs.Get(key);
+            if (compiled != nullptr &&
+                compiled->program.compare(0, string::npos, text, 0, split) != 0)
+                compiled = nullptr;     // a different program with the same hash
+            compile = (compiled == nullptr);
+        }
+        source = (compiled != nullptr) ? text.substr(split) : text;
+    }
+
+    istringstream in(source);
+    ostringstream reply;
+    Parser parser(in, reply);
+    parser.setOptions(argc, argv);
+    parser.throwOnError = true;
+    if (compiled != nullptr) {
+        parser.cachedBody = compiled->body.data();
+        parser.cachedBodySize = compiled->body.size();
+    }
+    parser.keepCompiled = compile;
+    try {
+        parser.input();
+    } catch (ParseStopped&) {
+    } catch (exception& e) {
+        // Anything else is a bug in the parser, but it must only fail this
+        // request, not take down the worker and with it the server.
+        parser.out.Flush();
+        reply << "Error: " << e.what() << endl;
+        compile = false;
+    }
+    if (compile && !parser.compiledBody.empty()) {
+        shared_ptr<CompiledProgram> entry = make_shared<CompiledProgram>();
+        entry->program = text.substr(0, split);
+        entry->body.swap(parser.compiledBody);
+        programs.Put(key, entry);
+    }
+    return reply.str();
+}
+
+// Reads until the client shuts down its write side. Fails on an error or
+// when SO_RCVTIMEO expires (errno EAGAIN).
+static bool ReadAll(int fd, string& text)
+{
+    char buf[1 << 16];
+    while (true) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n == 0)
+            return true;
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return false;
+        text.append(buf, n);
+    }
+}
+
+static void WriteAll(int fd, const string& text)
+{
+    size_t done = 0;
+    while (done < text.size()) {
+        ssize_t n = write(fd, text.data() + done, text.size() - done);
+        if (n <= 0)
+            return;
+        done += n;
+    }
+}
+
+int RunServer(const string& path, int argc, char* argv[])
+{
+    int workers = 4;
+    size_t lruSize = 64;
+    int timeout = 10;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (string(argv[i]) == "--workers")
+            workers = max(1, atoi(argv[i + 1]));
+        else if (string(argv[i]) == "--lru")
+            lruSize = max(1, atoi(argv[i + 1]));
+        else if (string(argv[i]) == "--timeout")
+            timeout = max(1, atoi(argv[i + 1]));
+    }
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        cerr << "Error: socket path too long: " << path << endl;
+        return 1;
+    }
+    strcpy(addr.sun_path, path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0 || bind(listener, (sockaddr*) &addr, sizeof(addr)) != 0 ||
+        listen(listener, 64) != 0) {
+        cerr << "Error: cannot listen on " << path << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    CompiledProgramLRU programs(lruSize);
+    mutex lock;
+    condition_variable cv;
+    deque<int> pending;
+
+    auto worker = [&]() {
+        while (true) {
+            int client;
+            {
+                unique_lock<mutex> guard(lock);
+                cv.wait(guard, [&]() { return !pending.empty(); });
+                client = pending.front();
+                pending.pop_front();
+            }
+            timeval limit = {timeout, 0};
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &limit, sizeof(limit));
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof(limit));
+            string request;
+            if (ReadAll(client, request))
+                WriteAll(client, HandleRequest(request, programs, argc, argv));
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                WriteAll(client, "Error: request timed out\n");
+            close(client);
+        }
+    };
+    vector<thread> pool;
+    for (int i = 0; i < workers; i++)
+        pool.push_back(thread(worker));
+
+    while (true) {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR)
+                continue;
+            cerr << "Error: accept failed: " << strerror(errno) << endl;
+            break;
+        }
+        lock_guard<mutex> guard(lock);
+        pending.push_back(client);
+        cv.notify_one();
+    }
+    close(listener);
+    exit(1);
+}
@@ -0,0 +1,30 @@
+#ifndef __SERVER__H__
+#define __SERVER__H__
+
+#include <string>
+
+// Evaluation daemon (--serve PATH [--workers N] [--lru N] [--timeout SEC]).
+//
+// Listens on the Unix domain socket PATH. A client connects, writes one
+// request, shuts down its write side and reads the reply until the server
+// closes the connection. The reply is exactly what the CLI would print for
+// the same input: program output, SYNTAX ERROR or Semantic Error Code lines.
+//
+// A request is either
+//   - a whole program text, TASKS through INPUTS, or
+//   - "@<key>" followed by an INPUTS section, where <key> is the 16 hex
+//     digit hash of a program sent earlier (the text before INPUTS, as
+//     used for the .pcache file names). An unknown key is answered with
+//     "Error: unknown program <key>".
+//
+// Compiled programs are kept, with their text, in an LRU of N entries
+// (default 64). A full-text request only reuses an entry whose text matches,
+// and an entry is never replaced by a different program with the same hash.
+// Requests are served by N worker threads (default 4). Reads and writes on
+// a connection time out after SEC seconds (default 10), so a client that
+// never finishes its request holds a worker for at most that long; it gets
+// "Error: request timed out". Other options, such as --lazy or --format,
+// apply to every request.
+int RunServer(const std::string& path, int argc, char* argv[]);
+
+#endif  //__SERVER__H__
@@ -0,0 +1,135 @@
+#include "stats.h"
+
+#if POLY_STATS
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <sys/resource.h>
+
+using namespace std;
+
+// Counting replacement for the global operator new, on malloc(). Every form
+// of new and delete is replaced, so that all of them agree on malloc/free
+// (sanitizers check that they match). Allocations are only counted once
+// EnableAllocationCounting() has been called; until then the cost is a
+// relaxed load.
+static atomic<bool> countAllocations(false);
+static atomic<uint64_t> allocationCount(0);
+
+static void* allocate(size_t size) noexcept
+{
+    if (countAllocations.load(memory_order_relaxed))
+        allocationCount.fetch_add(1, memory_order_relaxed);
+    return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(size_t size)
+{
+    void* p = allocate(size);
+    if (p == nullptr)
+        throw bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) noexcept
+{
+    free(p);
+}
+
+void EnableAllocationCounting()
+{
+    countAllocations.store(true, memory_order_relaxed);
+}
+
+uint64_t AllocationCount()
+{
+    return allocationCount.load(memory_order_relaxed);
+}
+
+double WallSeconds()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const char* phaseNames[PHASE_COUNT] = {
+    "lex", "parse", "check", "compile", "execute", "analyze"
+};
+
+ProgramStats::ProgramStats()
+{
+    enabled = false;
+    for (int i = 0; i < PHASE_COUNT; i++)
+        phases[i] = PhaseStats{0, 0};
+    tokens = 0;
+    statementsExecuted = 0;
+    cache = "off";
+}
+
+// Polynomial names are IDs (letters and digits), so nothing needs escaping.
+void ProgramStats::WriteJson(ostream& os) const
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double lexSeconds = phases[PHASE_LEX].seconds;
+
+    os << "{\"phases\": {";
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        os << (i ? ", " : "") << "\"" << phaseNames[i] << "\": {\"ms\": "
+           << phases[i].seconds * 1000 << ", \"allocations\": "
+           << phases[i].allocations << "}";
+    }
+    os << "}, \"tokens\": " << tokens
+       << ", \"tokens_per_sec\": " << (lexSeconds > 0 ? tokens / lexSeconds : 0)
+       << ", \"statements_executed\": " << statementsExecuted
+       << ", \"evaluations\": {";
+    for (size_t i = 0; i < evaluations.size(); i++) {
+        os << (i ? ", " : "") << "\"" << evaluations[i].first << "\": "
+           << evaluations[i].second;
+    }
+    os << "}, \"cache\": \"" << cache << "\""
+       << ", \"peak_rss_kb\": " << usage.ru_maxrss << "}" << endl;
+}
+
+#endif  // POLY_STATS
@@ -0,0 +1,103 @@
+#ifndef __STATS__H__
+#define __STATS__H__
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Per-phase profiling (--stats).
+//
+// With --stats, a run that completes writes one JSON object to stderr: wall
+// time and allocation count per phase, tokens per second, statements
+// executed, evaluations per polynomial, cache use and peak memory.
+//
+// Build with -DPOLY_STATS=0 to compile all of it out: the timers become
+// empty, operator new is not replaced and --stats is ignored. In the
+// default build, a run without --stats still goes through the replaced
+// operator new, which costs one relaxed atomic load per allocation, and
+// reads the clock twice while tokenizing.
+
+#ifndef POLY_STATS
+#define POLY_STATS 1
+#endif
+
+enum StatsPhase {
+    PHASE_LEX,          // LexicalAnalyzer::Tokenize()
+    PHASE_PARSE,        // program() or loading a cached program, and INPUTS
+    PHASE_CHECK,        // semantic checks
+    PHASE_COMPILE,      // compilePolynomials()
+    PHASE_EXECUTE,      // executeProgram() / executeParallel()
+    PHASE_ANALYZE,      // tasks 3-5
+    PHASE_COUNT
+};
+
+struct PhaseStats {
+    double seconds;
+    uint64_t allocations;
+};
+
+#if POLY_STATS
+
+// Number of calls to operator new so far, in all threads, counted from the
+// first EnableAllocationCounting(). main() calls it before the lexer runs
+// when --stats is given.
+void EnableAllocationCounting();
+uint64_t AllocationCount();
+double WallSeconds();
+
+class ProgramStats {
+  public:
+    ProgramStats();
+    void WriteJson(std::ostream&) const;
+
+    bool enabled;
+    PhaseStats phases[PHASE_COUNT];
+    size_t tokens;
+    uint64_t statementsExecuted;
+    std::vector<std::pair<std::string, uint64_t> > evaluations;
+    const char* cache;      // "off", "hit" or "miss"
+};
+
+// Adds the time and allocations from construction to destruction to one
+// phase, if stats are enabled.
+class PhaseTimer {
+  public:
+    PhaseTimer(ProgramStats& s, StatsPhase p) : stats(s), phase(p) {
+        if (stats.enabled) {
+            start = WallSeconds();
+            startAllocations = AllocationCount();
+        }
+    }
+    ~PhaseTimer() {
+        if (stats.enabled) {
+            stats.phases[phase].seconds += WallSeconds() - start;
+            stats.phases[phase].allocations += AllocationCount() - startAllocations;
+        }
+    }
+
+  private:
+    ProgramStats& stats;
+    StatsPhase phase;
+    double start;
+    uint64_t startAllocations;
+};
+
+#else
+
+class ProgramStats {
+  public:
+    ProgramStats() : enabled(false) {}
+    void WriteJson(std::ostream&) const {}
+    bool enabled;
+};
+
+class PhaseTimer {
+  public:
+    PhaseTimer(ProgramStats&, StatsPhase) {}
+};
+
+#endif  // POLY_STATS
+
+#endif  //__STATS__H__
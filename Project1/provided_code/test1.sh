@@ -1,4 +1,10 @@
 #!/bin/bash
+#
+#   ./test1.sh [a.out options]
+#
+# Runs ./a.out on every provided test and compares its output with the
+# .expected file. Options, such as --threads 3, are passed on to a.out.
+# Exits with status 1 if any test fails.
 
 if [ ! -d "./provided_tests" ]; then
     echo "Error: tests directory not found!"
@@ -26,7 +32,7 @@ for test_file in $(find ./provided_tests -type f -name "*.txt" | sort); do
     expected_file=${test_file}.expected
     output_file=./output/${name}.output
     diff_file=./output/${name}.diff
-    ./a.out < ${test_file} > ${output_file}
+    ./a.out "$@" < ${test_file} > ${output_file}
 
 
     folder_name="$(cut -d'/' -f3 <<<"${test_file}")"
@@ -78,7 +84,9 @@ for test_file in $(find ./provided_tests -type f -name "*.txt" | sort); do
 done
 
 echo
-echo "Passed $count tests out of $all"
+echo "Passed $count tests out of $all${*:+ with $*}"
 echo
 
 rmdir ./output
+
+[ $count -eq $all ]
@@ -0,0 +1,25 @@
+#!/bin/bash
+#
+#   ./test_modes.sh
+#
+# Runs test1.sh once per execution mode below, so the provided tests also
+# cover the parallel executor and lazy execution. Prints one summary line
+# per mode and exits with status 1 if any mode has a failing test; run
+# test1.sh with the same options to see the diffs.
+
+cd "$(dirname "$0")"
+
+modes=(
+    ""
+    "--threads 3"
+    "--lazy"
+    "--lazy --threads 3"
+)
+
+status=0
+for mode in "${modes[@]}"; do
+    result=$(bash test1.sh $mode) || status=1
+    grep "^Passed" <<< "$result" || echo "$result"
+done
+
+exit $status